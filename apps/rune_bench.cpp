@@ -0,0 +1,535 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <ostream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+#include "rune/cell.hpp"
+#include "rune/converter.hpp"
+#include "rune/kernel.hpp"
+#include "rune/ramp.hpp"
+#include "rune/writer.hpp"
+
+// Per-stage benchmark for the conversion pipeline.
+//
+// Every stage runs on its own over fixed inputs: a synthetic 1280x720 frame and,
+// when present, the bundled input/01.jpg. A full raw-stream video run follows at
+// several widths. Each result is one JSON line on stdout with time per iteration,
+// cells/s, bytes/s, frames/s and heap allocations per frame, counted by the global
+// operator new below. Progress output from the library is suppressed while timing.
+// --check-allocs exits non-zero if the video loop (at any --threads) allocates once warm.
+
+namespace {
+
+    std::atomic<uint64_t> allocation_count { 0 };
+    std::atomic<uint64_t> allocation_bytes { 0 };
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept {
+    return ::operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+    // Discards everything; keeps the ostream formatting cost without any I/O
+    class NullBuffer : public std::streambuf {
+    protected:
+        int overflow(int c) override { return c; }
+        std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+    };
+
+    // The writers this bench compares against, copied verbatim from the baseline
+    // (a71b007:src/writer.cpp) together with the array-of-structs cell they took;
+    // only [[maybe_unused]] is added, for the image buffer neither of them reads
+    namespace legacy {
+
+        struct Cell {
+            std::string glyph;
+            float h;      // hue   [0–255]  → map to [0–360] in renderer
+            float s;      // sat   [0–255]
+            float l;      // lum [0–255]
+        };
+
+        // The baseline's cells for a frame, built outside the timed region. Saturation and
+        // lightness sit half a percent up so the baseline's truncation gives back the integer
+        std::vector<Cell> cells_of(const rune::CellBuffer& cells) {
+            std::vector<Cell> out(cells.size());
+            for (size_t i = 0; i < cells.size(); ++i) {
+                out[i] = Cell { cells.glyph(i), static_cast<float>(cells.h[i]), (cells.s[i] + 0.5f) / 100.0f, (cells.l[i] + 0.5f) / 100.0f };
+            }
+            return out;
+        }
+
+        void write_cells(
+            std::ostream& out,
+            [[maybe_unused]] rune::converter::ImageBuffer& image_buffer,
+            const std::vector<Cell>& cells
+        ) {
+
+            out << R"({"cells":[)";
+
+            for (size_t i = 0; i < cells.size(); ++i) {
+                const auto& c = cells[i];
+
+                out << R"({"g":")";
+
+                // Escape special JSON characters and encode UTF-8 as \uXXXX
+                if (c.glyph == "\\") {
+                    out << "\\\\";
+                } else if (c.glyph == "\"") {
+                    out << "\\\"";
+                } else if (c.glyph == "\b") {
+                    out << "\\b";
+                } else if (c.glyph == "\f") {
+                    out << "\\f";
+                } else if (c.glyph == "\n") {
+                    out << "\\n";
+                } else if (c.glyph == "\r") {
+                    out << "\\r";
+                } else if (c.glyph == "\t") {
+                    out << "\\t";
+                } else if (c.glyph.size() == 1 && static_cast<unsigned char>(c.glyph[0]) < 128) {
+                    // ASCII character - output directly
+                    out << c.glyph;
+                } else {
+                    // Multi-byte UTF-8 - convert to Unicode code point and escape as \uXXXX
+                    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(c.glyph.data());
+                    uint32_t codepoint = 0;
+
+                    if ((bytes[0] & 0x80) == 0) {
+                        codepoint = bytes[0];
+                    } else if ((bytes[0] & 0xE0) == 0xC0 && c.glyph.size() >= 2) {
+                        codepoint = ((bytes[0] & 0x1F) << 6) | (bytes[1] & 0x3F);
+                    } else if ((bytes[0] & 0xF0) == 0xE0 && c.glyph.size() >= 3) {
+                        codepoint = ((bytes[0] & 0x0F) << 12) | ((bytes[1] & 0x3F) << 6) | (bytes[2] & 0x3F);
+                    } else if ((bytes[0] & 0xF8) == 0xF0 && c.glyph.size() >= 4) {
+                        codepoint = ((bytes[0] & 0x07) << 18) | ((bytes[1] & 0x3F) << 12) | ((bytes[2] & 0x3F) << 6) | (bytes[3] & 0x3F);
+                    }
+
+                    // Output as \uXXXX
+                    out << "\\u" << std::hex << std::setfill('0') << std::setw(4) << codepoint << std::dec;
+                }
+
+                out << R"(","h":)" << static_cast<int>(c.h) << R"(,"s":)" << static_cast<int>(c.s * 100.0f) << R"(,"l":)" << static_cast<int>(c.l * 100.0f) << R"(})";
+
+                if (i + 1 < cells.size()) {
+                    out << ",";
+                }
+
+            }
+
+            out << R"(]})" << "\n";
+        }
+
+        void write_cells_gzip(
+            gzFile gz,
+            [[maybe_unused]] rune::converter::ImageBuffer& image_buffer,
+            const std::vector<Cell>& cells
+        ) {
+            auto write = [&](const std::string& s) {
+                gzwrite(gz, s.data(), static_cast<unsigned int>(s.size()));
+            };
+
+            write(R"({"cells":[)");
+
+            for (size_t i = 0; i < cells.size(); ++i) {
+                const auto& c = cells[i];
+
+                write(R"({"g":")");
+
+                // Escape special JSON characters and encode UTF-8 as \uXXXX
+                if (c.glyph == "\\") {
+                    write("\\\\");
+                } else if (c.glyph == "\"") {
+                    write("\\\"");
+                } else if (c.glyph == "\b") {
+                    write("\\b");
+                } else if (c.glyph == "\f") {
+                    write("\\f");
+                } else if (c.glyph == "\n") {
+                    write("\\n");
+                } else if (c.glyph == "\r") {
+                    write("\\r");
+                } else if (c.glyph == "\t") {
+                    write("\\t");
+                } else if (c.glyph.size() == 1 && static_cast<unsigned char>(c.glyph[0]) < 128) {
+                    // ASCII character - output directly
+                    write(c.glyph);
+                } else {
+                    // Multi-byte UTF-8 - convert to Unicode code point and escape as \uXXXX
+                    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(c.glyph.data());
+                    uint32_t codepoint = 0;
+
+                    if ((bytes[0] & 0x80) == 0) {
+                        codepoint = bytes[0];
+                    } else if ((bytes[0] & 0xE0) == 0xC0 && c.glyph.size() >= 2) {
+                        codepoint = ((bytes[0] & 0x1F) << 6) | (bytes[1] & 0x3F);
+                    } else if ((bytes[0] & 0xF0) == 0xE0 && c.glyph.size() >= 3) {
+                        codepoint = ((bytes[0] & 0x0F) << 12) | ((bytes[1] & 0x3F) << 6) | (bytes[2] & 0x3F);
+                    } else if ((bytes[0] & 0xF8) == 0xF0 && c.glyph.size() >= 4) {
+                        codepoint = ((bytes[0] & 0x07) << 18) | ((bytes[1] & 0x3F) << 12) | ((bytes[2] & 0x3F) << 6) | (bytes[3] & 0x3F);
+                    }
+
+                    // Output as \uXXXX
+                    std::stringstream ss;
+                    ss << "\\u" << std::hex << std::setfill('0') << std::setw(4) << codepoint;
+                    write(ss.str());
+                }
+
+                write(R"(","h":)");
+                write(std::to_string(static_cast<int>(c.h))); // h is degrees (0-360)
+                write(R"(,"s":)");
+                write(std::to_string(static_cast<int>(c.s * 100.0f))); // s is ratio -> percentage (0-100)
+                write(R"(,"l":)");
+                write(std::to_string(static_cast<int>(c.l * 100.0f))); // l is ratio -> percentage (0-100)
+                write("}");
+
+                if (i + 1 < cells.size()) {
+                    write(",");
+                }
+            }
+
+            write("]}\n");
+        }
+
+    } // namespace legacy
+
+    // Deterministic gradient with some texture, so every stage sees varied colours
+    rune::converter::ImageBuffer make_image(int width, int height) {
+        rune::converter::ImageBuffer image;
+        image.width = width;
+        image.height = height;
+        image.channels = 3;
+        image.pixels.resize(static_cast<size_t>(width) * height * 3);
+
+        uint32_t state = 12345;
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                state = state * 1664525u + 1013904223u;
+                uint8_t* p = image.pixels.data() + (static_cast<size_t>(y) * width + x) * 3;
+                p[0] = static_cast<uint8_t>(x * 255 / width);
+                p[1] = static_cast<uint8_t>(y * 255 / height);
+                p[2] = static_cast<uint8_t>((x ^ y) + (state >> 28));
+            }
+        }
+        return image;
+    }
+
+    struct Measure {
+        const char* stage;
+        std::string input;
+        int width;
+        size_t cells;   // Cells produced or consumed per iteration
+        size_t bytes;   // Bytes produced or consumed per iteration
+        int frames = 1; // Frames per iteration
+    };
+
+    // Runs fn once to warm up (first-use allocations, caches), then `iterations` times
+    template <typename Fn>
+    void run(const Measure& m, int iterations, Fn&& fn) {
+        fn();
+
+        const uint64_t count_before = allocation_count.load();
+        const uint64_t bytes_before = allocation_bytes.load();
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            fn();
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const double frames = static_cast<double>(iterations) * m.frames;
+        const double allocs = static_cast<double>(allocation_count.load() - count_before) / frames;
+        const double alloc_bytes = static_cast<double>(allocation_bytes.load() - bytes_before) / frames;
+
+        std::ostringstream line;
+        line << "{\"stage\":\"" << m.stage << "\""
+             << ",\"input\":\"" << m.input << "\""
+             << ",\"width\":" << m.width
+             << ",\"iterations\":" << iterations
+             << ",\"ms_per_iter\":" << seconds * 1e3 / iterations
+             << ",\"cells_per_s\":" << m.cells * iterations / seconds
+             << ",\"bytes_per_s\":" << m.bytes * iterations / seconds
+             << ",\"frames_per_s\":" << frames / seconds
+             << ",\"allocs_per_frame\":" << allocs
+             << ",\"alloc_bytes_per_frame\":" << alloc_bytes
+             << "}\n";
+        std::cout << line.str() << std::flush;
+    }
+
+    // Silences std::cout (progress bars) for the lifetime of the guard
+    class QuietCout {
+    public:
+        QuietCout() : saved_(std::cout.rdbuf(&null_)) {}
+        ~QuietCout() { std::cout.rdbuf(saved_); }
+
+    private:
+        NullBuffer null_;
+        std::streambuf* saved_;
+    };
+
+    void bench_stages(const rune::converter::ImageBuffer& image, const std::string& input, int width, int iterations, const std::string& path) {
+        namespace conv = rune::converter;
+        const rune::Ramp& ramp = rune::ramps::SIMPLE;
+        const size_t image_bytes = image.pixels.size();
+        const size_t image_pixels = static_cast<size_t>(image.width) * image.height;
+
+        if (!path.empty()) {
+            const size_t file_bytes = static_cast<size_t>(std::filesystem::file_size(path));
+            run({ "load_image_pixels", input, width, image_pixels, file_bytes }, iterations, [&] {
+                conv::ImageBuffer loaded = conv::load_image_pixels(path);
+            });
+        }
+
+        const int rows = conv::cell_rows(image, width);
+        const size_t cells = static_cast<size_t>(width) * rows;
+
+        run({ "resize_image_pixels", input, width, cells, image_bytes }, iterations, [&] {
+            conv::ImageBuffer resized = conv::resize_image_pixels(image, width);
+        });
+        run({ "downsample_to_grid", input, width, cells, image_bytes }, iterations, [&] {
+            conv::ImageBuffer grid = conv::downsample_to_grid(image, width, rows);
+        });
+
+        const conv::ImageBuffer grid = conv::downsample_to_grid(image, width, rows);
+
+        run({ "pixels_to_cells", input, width, cells, grid.pixels.size() }, iterations, [&] {
+            rune::CellBuffer out = conv::pixels_to_cells(grid, ramp, 1.0f);
+        });
+
+        volatile float sink = 0.0f;
+        run({ "rgb_to_hsl", input, width, cells, grid.pixels.size() }, iterations, [&] {
+            float acc = 0.0f;
+            for (size_t i = 0; i < cells; ++i) {
+                const uint8_t* p = grid.pixels.data() + i * 3;
+                acc += conv::rgb_to_hsl(p[0], p[1], p[2]).l;
+            }
+            sink = sink + acc;
+        });
+
+        conv::AsciiFrame frame;
+        frame.image_buffer = grid;
+        frame.cells = conv::pixels_to_cells(grid, ramp, 1.0f);
+        frame.ramp = &ramp;
+
+        conv::add_html(frame);
+        run({ "add_html", input, width, cells, frame.html.size() }, iterations, [&] {
+            conv::add_html(frame);
+        });
+
+        // The per-frame path of the video loop: every buffer is reused after the warm-up
+        conv::FrameContext context;
+        conv::AsciiFrame reused;
+        run({ "convert_frame_reused", input, width, cells, image_bytes }, iterations, [&] {
+            conv::convert_frame_to_ascii(image, width, ramp, 1.0f, nullptr, context, reused);
+            conv::add_html(reused);
+        });
+
+        NullBuffer null_buffer;
+        std::ostream null_out(&null_buffer);
+        rune::writer::JsonSerializer serializer;
+        const size_t json_bytes = serializer.serialize_cells(frame.cells).size();
+
+        run({ "write_cells", input, width, cells, json_bytes }, iterations, [&] {
+            rune::writer::write_cells(null_out, frame.cells);
+        });
+        // The baseline took an array of Cell structs and an image buffer it did not read
+        const std::vector<legacy::Cell> legacy_cells = legacy::cells_of(frame.cells);
+        conv::ImageBuffer unused_image;
+        run({ "write_cells_legacy", input, width, cells, json_bytes }, iterations, [&] {
+            legacy::write_cells(null_out, unused_image, legacy_cells);
+        });
+
+        rune::writer::GzipWriter gz;
+        gz.open("/dev/null");
+        run({ "write_cells_gzip", input, width, cells, json_bytes }, iterations, [&] {
+            rune::writer::write_cells_gzip(gz, frame.cells);
+        });
+        gz.close();
+
+        gzFile legacy_gz = gzopen("/dev/null", "wb");
+        run({ "write_cells_gzip_legacy", input, width, cells, json_bytes }, iterations, [&] {
+            legacy::write_cells_gzip(legacy_gz, unused_image, legacy_cells);
+        });
+        gzclose(legacy_gz);
+    }
+
+    // `frames` copies of one frame as a packed RGB24 stream
+    std::string make_raw_stream(const rune::converter::ImageBuffer& frame, int frames) {
+        std::string raw;
+        raw.reserve(frame.pixels.size() * frames);
+        for (int i = 0; i < frames; ++i) {
+            raw.append(reinterpret_cast<const char*>(frame.pixels.data()), frame.pixels.size());
+            // Shift a band each frame so consecutive frames differ
+            raw[raw.size() - frame.pixels.size() + (static_cast<size_t>(i) * 3 * 97) % frame.pixels.size()] ^= 0x55;
+        }
+        return raw;
+    }
+
+    void convert_raw_stream(std::string& raw, const rune::converter::ImageBuffer& frame, int width, const std::string& folder, const rune::converter::ConvertOptions& options) {
+        std::FILE* in = fmemopen(raw.data(), raw.size(), "rb");
+        QuietCout quiet;
+        rune::converter::convert_raw_stream_to_ascii(in, frame.width, frame.height, width, 8, folder, rune::ramps::SIMPLE, 1.0f, options);
+        std::fclose(in);
+    }
+
+    // Whole raw-stream conversion (decode excluded) into a scratch folder.
+    // Returns the heap allocations per frame once the loop is warm: a run of 2N
+    // frames minus a run of N frames leaves only what each extra frame costs.
+    double bench_video(const rune::converter::ImageBuffer& frame, int width, int frames, int threads) {
+        namespace conv = rune::converter;
+
+        std::string raw = make_raw_stream(frame, frames);
+        std::string raw_twice = make_raw_stream(frame, frames * 2);
+
+        const std::string folder = (std::filesystem::temp_directory_path() / "rune_bench_video").string();
+        conv::ConvertOptions options;
+        options.threads = threads;
+
+        const size_t cells = static_cast<size_t>(width) * conv::cell_rows(frame, width) * frames;
+        const std::string input = "synthetic_video_x" + std::to_string(frames) + "_threads" + std::to_string(threads);
+
+        run({ "video", input, width, cells, raw.size(), frames }, 1, [&] {
+            convert_raw_stream(raw, frame, width, folder, options);
+        });
+
+        const uint64_t before = allocation_count.load();
+        convert_raw_stream(raw, frame, width, folder, options);
+        const uint64_t single = allocation_count.load() - before;
+        convert_raw_stream(raw_twice, frame, width, folder, options);
+        const uint64_t twice = allocation_count.load() - before - single;
+        const double marginal = (static_cast<double>(twice) - static_cast<double>(single)) / frames;
+
+        std::cout << "{\"stage\":\"video_steady_state\",\"input\":\"" << input << "\""
+                  << ",\"width\":" << width
+                  << ",\"allocs_per_frame\":" << marginal
+                  << "}\n" << std::flush;
+
+        std::filesystem::remove_all(folder);
+        return marginal;
+    }
+
+    std::vector<int> parse_widths(const std::string& list) {
+        std::vector<int> widths;
+        std::stringstream ss(list);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            if (!item.empty()) widths.push_back(std::stoi(item));
+        }
+        return widths;
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<int> widths = { 80, 120, 200 };
+    int iterations = 20;
+    int video_frames = 30;
+    int threads = 1;
+    bool check_allocs = false;
+    std::string image_path = "input/01.jpg";
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        if (arg == "--widths" && i + 1 < argc) {
+            widths = parse_widths(argv[++i]);
+        }
+        else if (arg == "--iterations" && i + 1 < argc) {
+            iterations = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (arg == "--video-frames" && i + 1 < argc) {
+            video_frames = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (arg == "--image" && i + 1 < argc) {
+            image_path = argv[++i];
+        }
+        else if (arg == "--check-allocs") {
+            check_allocs = true;
+        }
+        else {
+            std::cerr << "usage: rune_bench [--widths 80,120,200] [--iterations N] [--video-frames N] [--threads N] [--image path] [--check-allocs]\n";
+            return 1;
+        }
+    }
+
+    std::cout << "{\"bench\":\"rune\",\"isa\":\"" << rune::kernel::isa_name(rune::kernel::detect_isa()) << "\"}\n";
+
+    // The serializer must match the reference writer before any of its numbers count
+    {
+        const rune::converter::ImageBuffer image = make_image(320, 180);
+        rune::converter::AsciiFrame frame = rune::converter::convert_frame_to_ascii(image, 120, rune::ramps::BLOCKS, 1.0f);
+        std::ostringstream reference;
+        rune::converter::ImageBuffer unused_image;
+        legacy::write_cells(reference, unused_image, legacy::cells_of(frame.cells));
+        rune::writer::JsonSerializer serializer;
+        if (reference.str() != serializer.serialize_cells(frame.cells)) {
+            std::cerr << "serializer output differs from the reference writer\n";
+            return 1;
+        }
+    }
+
+    const rune::converter::ImageBuffer synthetic = make_image(1280, 720);
+
+    rune::converter::ImageBuffer bundled;
+    bool have_bundled = std::filesystem::exists(image_path);
+    if (have_bundled) {
+        bundled = rune::converter::load_image_pixels(image_path);
+    } else {
+        std::cerr << "skipping " << image_path << " (not found)\n";
+    }
+
+    for (int width : widths) {
+        bench_stages(synthetic, "synthetic_1280x720", width, iterations, "");
+        if (have_bundled) {
+            bench_stages(bundled, image_path, width, iterations, image_path);
+        }
+    }
+
+    // With --check-allocs a video loop that still allocates per frame fails the run
+    bool steady = true;
+    for (int width : widths) {
+        const double marginal = bench_video(synthetic, width, video_frames, threads);
+        if (marginal > 0.0) steady = false;
+    }
+
+    if (check_allocs && !steady) {
+        std::cerr << "video loop allocates in steady state\n";
+        return 1;
+    }
+
+    return 0;
+}
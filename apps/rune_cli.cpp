@@ -1,33 +1,64 @@
 #include <cstddef>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <string>
+#include <csignal>
+#include <cstdio>
+#include <thread>
+#include <algorithm>
+#include <chrono>
+#include <vector>
 
+#include "rune/batch.hpp"
+#include "rune/cache.hpp"
 #include "rune/converter.hpp"
+#include "rune/profile.hpp"
 #include "rune/ramp.hpp"
+#include "rune/stream.hpp"
 
 int main(int argc, char** argv) {
     if (argc < 2) {
         std::cerr << "usage:\n"
-                  << "  rune_cli --image <filename> [--width N] [--ramp simple|dense|blocks|dot|dot2] [--custom-ramp <string>] [--threshold 0-1] [--out folder]\n"
-                  << "  rune_cli --video <filename> [--width N] [--target-fps N] [--ramp simple|dense|blocks|dot|dot2] [--custom-ramp <filename>] [--threshold 0-1] [--out folder]\n";
+                  << "  rune_cli --image <filename> [--width N] [--ramp simple|dense|blocks|dot|dot2] [--custom-ramp <string>] [--threshold 0-1] [--lut-bits 1-8] [--format jsonl|runeb] [--deflate-frames] [--palette N] [--gzip-level 0-9] [--gzip-threads N] [--gzip-block-size KiB] [--cache folder] [--cache-size MB] [--cache-memory MB] [--io-queue MB] [--no-io-uring] [--fsync] [--profile] [--report file.json] [--quiet] [--out folder]\n"
+                  << "  rune_cli --video <filename> [--width N[,N...]] [--target-fps N] [--ramp simple|dense|blocks|dot|dot2] [--custom-ramp <filename>] [--threshold 0-1] [--threads N] [--lut-bits 1-8] [--format jsonl|runeb] [--deflate-frames] [--palette N] [--keyframe-interval N] [--delta-tolerance N] [--seek-interval N] [--segment-seconds S] [--gzip-level 0-9] [--gzip-threads N] [--gzip-block-size KiB] [--raw-size WxH] [--cache folder] [--cache-size MB] [--cache-memory MB] [--io-queue MB] [--no-io-uring] [--fsync] [--profile] [--report file.json] [--quiet] [--out folder]\n"
+                  << "  rune_cli --batch <folder|glob|list file> [--width N] [--ramp simple|dense|blocks|dot|dot2] [--custom-ramp <string>] [--threshold 0-1] [--threads N] [--lut-bits 1-8] [--format jsonl|runeb] [--deflate-frames] [--palette N] [--cache folder] [--cache-size MB] [--cache-memory MB] [--io-queue MB] [--no-io-uring] [--fsync] [--profile] [--report file.json] [--quiet] [--out folder]\n"
+                  << "  rune_cli --stream <filename|-> --raw-size WxH [--width N] [--target-fps N] [--ramp simple|dense|blocks|dot|dot2] [--custom-ramp <string>] [--threshold 0-1] [--lut-bits 1-8] [--keyframe-interval N] [--delta-tolerance N] [--cache-memory MB] [--profile] [--report file.json]\n";
         return 1;
     }
 
     std::string input = argv[2];
     std::string output;
     int width = 120;
+    std::vector<int> widths;  // All of --width when it is a list (a rendition ladder)
     int target_fps = 8;
     std::string ramp_name = "simple";
     rune::Ramp custom_ramp_obj;
     std::string custom_ramp;
     float threshold = 1.0f;  // Default 1.0 = no filtering (all colors survive)
+    rune::converter::ConvertOptions options;
+    bool profile = false;
+    std::string report_path;
+    int raw_width = 0;
+    int raw_height = 0;
+    int cache_memory_mb = -1;
 
     for (int i = 3; i < argc; ++i) {
         std::string arg = argv[i];
 
         if (arg == "--width" && i + 1 < argc) {
-            width = std::stoi(argv[++i]);
+            // "80,120,200" converts a video at every width from one decode pass
+            std::stringstream list(argv[++i]);
+            std::string item;
+            widths.clear();
+            while (std::getline(list, item, ',')) {
+                if (!item.empty()) widths.push_back(std::stoi(item));
+            }
+            if (widths.empty()) {
+                std::cerr << "invalid width list\n";
+                return 1;
+            }
+            width = widths.front();
         }
         else if (arg == "--target-fps" && i + 1 < argc) {
             target_fps = std::stoi(argv[++i]);
@@ -42,6 +73,97 @@ int main(int argc, char** argv) {
             threshold = std::stof(argv[++i]);
             threshold = std::clamp(threshold, 0.0f, 1.0f);
         }
+        else if (arg == "--threads" && i + 1 < argc) {
+            options.threads = std::stoi(argv[++i]);
+            // 0 picks one worker per hardware thread
+            if (options.threads <= 0) {
+                options.threads = std::max(1u, std::thread::hardware_concurrency());
+            }
+        }
+        else if (arg == "--lut-bits" && i + 1 < argc) {
+            // Map colours through a precomputed table instead of per-pixel math
+            options.lut_bits = std::clamp(std::stoi(argv[++i]), 0, 8);
+        }
+        else if (arg == "--format" && i + 1 < argc) {
+            std::string format = argv[++i];
+            if (format == "jsonl") {
+                options.format = rune::converter::OutputFormat::Jsonl;
+            } else if (format == "runeb") {
+                options.format = rune::converter::OutputFormat::Runeb;
+            } else {
+                std::cerr << "unknown format: " << format << "\n";
+                return 1;
+            }
+        }
+        else if (arg == "--deflate-frames") {
+            options.deflate_frames = true;
+        }
+        else if (arg == "--keyframe-interval" && i + 1 < argc) {
+            options.keyframe_interval = std::stoi(argv[++i]);
+        }
+        else if (arg == "--delta-tolerance" && i + 1 < argc) {
+            options.delta_tolerance = std::stoi(argv[++i]);
+        }
+        else if (arg == "--seek-interval" && i + 1 < argc) {
+            options.seek_interval = std::stoi(argv[++i]);
+        }
+        else if (arg == "--gzip-level" && i + 1 < argc) {
+            options.gzip_level = std::stoi(argv[++i]);
+        }
+        else if (arg == "--gzip-threads" && i + 1 < argc) {
+            options.gzip_threads = std::stoi(argv[++i]);
+        }
+        else if (arg == "--gzip-block-size" && i + 1 < argc) {
+            // KiB of JSONL per parallel deflate block
+            options.gzip_block_kb = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (arg == "--raw-size" && i + 1 < argc) {
+            // Input is a raw RGB24 stream of this frame size ("-" reads stdin)
+            std::string size = argv[++i];
+            size_t x = size.find('x');
+            if (x == std::string::npos) {
+                std::cerr << "invalid raw size: " << size << "\n";
+                return 1;
+            }
+            raw_width = std::stoi(size.substr(0, x));
+            raw_height = std::stoi(size.substr(x + 1));
+        }
+        else if (arg == "--palette" && i + 1 < argc) {
+            options.palette_size = std::stoi(argv[++i]);
+        }
+        else if (arg == "--segment-seconds" && i + 1 < argc) {
+            // Video frame files are cut into chunks of this length, listed in playlist.json
+            options.segment_seconds = std::max(0.0, std::stod(argv[++i]));
+        }
+        else if (arg == "--cache" && i + 1 < argc) {
+            // Converted frames are reused across runs, keyed by their decoded pixels
+            options.cache_dir = argv[++i];
+        }
+        else if (arg == "--cache-size" && i + 1 < argc) {
+            options.cache_disk_mb = std::max(0, std::stoi(argv[++i]));
+        }
+        else if (arg == "--cache-memory" && i + 1 < argc) {
+            cache_memory_mb = std::max(0, std::stoi(argv[++i]));
+        }
+        else if (arg == "--io-queue" && i + 1 < argc) {
+            // Frame files are written by a background thread with up to this much queued (0 = inline)
+            options.io_queue_mb = std::max(0, std::stoi(argv[++i]));
+        }
+        else if (arg == "--no-io-uring") {
+            options.io_uring = false;
+        }
+        else if (arg == "--fsync") {
+            options.fsync = true;
+        }
+        else if (arg == "--profile") {
+            profile = true;
+        }
+        else if (arg == "--report" && i + 1 < argc) {
+            report_path = argv[++i];
+        }
+        else if (arg == "--quiet") {
+            options.quiet = true;
+        }
         else if (arg == "--out" && i + 1 < argc) {
             output = argv[++i];
         }
@@ -51,9 +173,17 @@ int main(int argc, char** argv) {
         }
     }
 
+    // A disk cache gets a memory tier in front of it unless one was sized explicitly
+    if (cache_memory_mb >= 0) {
+        options.cache_memory_mb = cache_memory_mb;
+    } else if (!options.cache_dir.empty()) {
+        options.cache_memory_mb = 64;
+    }
+
     // Select the ramp based on the ramp_name
     const rune::Ramp* ramp = &rune::ramps::SIMPLE;
     if (!custom_ramp.empty()) {
+        // Compiled once here; the built-in ramps are compiled with the program
         custom_ramp_obj = rune::Ramp {custom_ramp};
         ramp = &custom_ramp_obj;
     } else if (ramp_name == "simple") {
@@ -73,15 +203,96 @@ int main(int argc, char** argv) {
 
     std::string mode = argv[1];
 
+    if (widths.size() > 1 && mode != "--video") {
+        std::cerr << "a list of widths is only supported with --video\n";
+        return 1;
+    }
+    if (widths.empty()) {
+        widths.push_back(width);
+    }
+
+    // Stage timers and latency samples only cost anything when a profiler is installed
+    rune::profile::Profiler profiler;
+    rune::profile::Session profile_session((profile || !report_path.empty()) ? &profiler : nullptr);
+
     if (mode == "--image") {
-        rune::converter::convert_image_to_ascii(input, width, output, *ramp, threshold);
+        rune::converter::convert_image_to_ascii(input, width, output, *ramp, threshold, options);
+    } else if (mode == "--video" && raw_width > 0) {
+        std::FILE* in = (input == "-") ? stdin : std::fopen(input.c_str(), "rb");
+        if (!in) {
+            std::cerr << "failed to open input: " << input << "\n";
+            return 1;
+        }
+        const bool converted = rune::converter::convert_raw_stream_to_ascii(in, raw_width, raw_height, widths, target_fps, output, *ramp, threshold, options);
+        if (in != stdin) std::fclose(in);
+        if (!converted) {
+            return 1;
+        }
+    } else if (mode == "--batch") {
+        std::vector<std::string> inputs = rune::batch::collect_inputs(input);
+        if (inputs.empty()) {
+            std::cerr << "no images found: " << input << "\n";
+            return 1;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<rune::batch::ImageResult> results = rune::batch::convert_images(inputs, width, output, *ramp, threshold, options);
+        double wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        rune::batch::write_summary(results, output, wall_ms);
+    } else if (mode == "--stream") {
+        if (raw_width <= 0 || raw_height <= 0) {
+            std::cerr << "--stream needs --raw-size WxH\n";
+            return 1;
+        }
+        std::FILE* in = (input == "-") ? stdin : std::fopen(input.c_str(), "rb");
+        if (!in) {
+            std::cerr << "failed to open input: " << input << "\n";
+            return 1;
+        }
+
+        // A consumer that goes away should end the stream, not kill the process
+        std::signal(SIGPIPE, SIG_IGN);
+
+        // Frames go to stdout and the per-frame latency report to stderr
+        std::FILE* latency_out = options.quiet ? nullptr : stderr;
+        rune::stream::StreamStats stats = rune::stream::stream_raw_to_ascii(in, raw_width, raw_height, width, target_fps, stdout, latency_out, *ramp, threshold, options);
+        if (in != stdin) std::fclose(in);
+
+        std::cerr << "stream ended: " << stats.frames_in << " frames in, " << stats.frames_out << " out, "
+                  << stats.skipped << " skipped, " << stats.dropped << " dropped\n";
     } else if (mode == "--video") {
-        rune::converter::convert_video_to_ascii(input, width, target_fps, output, *ramp, threshold);
+        rune::converter::convert_video_to_ascii(input, widths, target_fps, output, *ramp, threshold, options);
     } else {
         std::cerr << "unknown mode: " << mode << "\n";
         return 1;
     }
 
-    std::cout << "\n\nconversion complete. thank you for using ᛚune\n" << std::endl;
+    profiler.stop();
+
+    // Stdout may be carrying --stream frames, so profiling output goes to stderr
+    if (profile) {
+        std::cerr << "\n";
+        profiler.print_stages(std::cerr);
+
+        if (auto frame_cache = rune::converter::cache_for(options)) {
+            const rune::cache::Stats stats = frame_cache->stats();
+            std::cerr << "cache: " << stats.memory_hits << " memory hits, " << stats.disk_hits << " disk hits, "
+                      << stats.misses << " misses, " << stats.evictions << " evictions\n";
+        }
+    }
+
+    if (!report_path.empty()) {
+        std::ofstream report_out(report_path);
+        if (!report_out) {
+            std::cerr << "failed to open output file\n";
+            return 1;
+        }
+        profiler.write_report(report_out, output);
+    }
+
+    if (!options.quiet && mode != "--stream") {
+        std::cout << "\n\nconversion complete. thank you for using ᛚune\n" << std::endl;
+    }
     return 0;
 }
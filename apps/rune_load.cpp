@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rune/server.hpp"
+
+// Load generator for rune_server: many clients each sending one image per connection
+int main(int argc, char** argv) {
+    std::string socket_path = "/tmp/rune.sock";
+    std::string image_path;
+    int requests = 1000;
+    int concurrency = 200;
+    rune::server::Request request;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        if (arg == "--socket" && i + 1 < argc) {
+            socket_path = argv[++i];
+        }
+        else if (arg == "--image" && i + 1 < argc) {
+            image_path = argv[++i];
+        }
+        else if (arg == "--requests" && i + 1 < argc) {
+            requests = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (arg == "--concurrency" && i + 1 < argc) {
+            concurrency = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (arg == "--width" && i + 1 < argc) {
+            request.width = std::stoi(argv[++i]);
+        }
+        else if (arg == "--ramp" && i + 1 < argc) {
+            request.ramp = argv[++i];
+        }
+        else if (arg == "--html") {
+            request.html = true;
+        }
+        else {
+            image_path.clear();
+            break;
+        }
+    }
+
+    if (image_path.empty()) {
+        std::cerr << "usage:\n"
+                  << "  rune_load --image <filename> [--socket path] [--requests N] [--concurrency N] [--width N] [--ramp name] [--html]\n";
+        return 1;
+    }
+
+    std::ifstream image_file(image_path, std::ios::binary);
+    if (!image_file) {
+        std::cerr << "failed to open image file\n";
+        return 1;
+    }
+    const std::string image((std::istreambuf_iterator<char>(image_file)), std::istreambuf_iterator<char>());
+
+    request.kind = rune::server::JobKind::Image;
+    request.bytes = image.size();
+    const std::string header = rune::server::format_request(request);
+
+    std::atomic<int> next { 0 };
+    std::atomic<int> ok { 0 }, busy { 0 }, failed { 0 };
+    std::atomic<uint64_t> frame_bytes { 0 };
+    rune::server::LatencyStats latency(static_cast<size_t>(requests));
+
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point started = Clock::now();
+
+    // Each client opens one connection per request, as a stateless caller would
+    auto client = [&] {
+        std::string line;
+        while (next++ < requests) {
+            const Clock::time_point sent = Clock::now();
+            try {
+                rune::server::Connection connection = rune::server::connect(socket_path);
+                connection.write_all(header);
+                connection.write_all(image);
+
+                bool done = false;
+                while (connection.read_line(line, 64u << 20)) {
+                    if (line.rfind("{\"done\"", 0) == 0) {
+                        done = true;
+                        break;
+                    }
+                    if (line == "{\"error\":\"busy\"}") {
+                        busy++;
+                        break;
+                    }
+                    if (line.rfind("{\"error\"", 0) == 0) {
+                        std::cerr << line << "\n";
+                        break;
+                    }
+                    frame_bytes += line.size() + 1;
+                }
+
+                if (done) {
+                    ok++;
+                    latency.record(std::chrono::duration<double, std::milli>(Clock::now() - sent).count());
+                } else if (line != "{\"error\":\"busy\"}") {
+                    failed++;
+                }
+            } catch (const std::exception&) {
+                failed++;
+            }
+        }
+    };
+
+    std::vector<std::thread> clients;
+    for (int i = 0; i < std::min(concurrency, requests); ++i) {
+        clients.emplace_back(client);
+    }
+    for (std::thread& thread : clients) {
+        thread.join();
+    }
+
+    const double seconds = std::chrono::duration<double>(Clock::now() - started).count();
+    std::printf("{\"requests\":%d,\"concurrency\":%d,\"ok\":%d,\"busy\":%d,\"failed\":%d,\"seconds\":%.3f,\"requests_per_s\":%.1f,\"frame_bytes\":%llu,\"latency_ms\":%s}\n",
+        requests, concurrency, ok.load(), busy.load(), failed.load(), seconds, ok.load() / seconds,
+        static_cast<unsigned long long>(frame_bytes.load()), latency.json().c_str());
+
+    // The server's own view, when it still accepts a request
+    try {
+        rune::server::Connection connection = rune::server::connect(socket_path);
+        rune::server::Request stats;
+        stats.kind = rune::server::JobKind::Stats;
+        connection.write_all(rune::server::format_request(stats));
+        std::string line;
+        if (connection.read_line(line, 1 << 16)) {
+            std::printf("%s\n", line.c_str());
+        }
+    } catch (const std::exception&) {
+    }
+
+    return failed.load() == 0 ? 0 : 1;
+}
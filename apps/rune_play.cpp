@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <csignal>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+#include "rune/jsonl.hpp"
+#include "rune/runeb.hpp"
+#include "rune/terminal.hpp"
+
+namespace {
+
+    volatile std::sig_atomic_t interrupted = 0;
+
+    void on_interrupt(int) {
+        interrupted = 1;
+    }
+
+    // Writes the whole buffer; write() may return early on a pipe or a busy tty
+    bool write_all(const std::string& data) {
+        const char* p = data.data();
+        size_t left = data.size();
+        while (left > 0) {
+            ssize_t n = ::write(STDOUT_FILENO, p, left);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            p += n;
+            left -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    bool ends_with(const std::string& s, const std::string& suffix) {
+        return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage:\n"
+                  << "  rune_play <frames.jsonl|frames.runeb|-> [--cols N] [--fps N] [--loop]\n";
+        return 1;
+    }
+
+    std::string input = argv[1];
+    int cols = 0;
+    int fps = 0;
+    bool loop = false;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        if (arg == "--cols" && i + 1 < argc) {
+            cols = std::stoi(argv[++i]);
+        }
+        else if (arg == "--fps" && i + 1 < argc) {
+            fps = std::stoi(argv[++i]);
+        }
+        else if (arg == "--loop") {
+            loop = true;
+        }
+        else {
+            std::cerr << "unknown argument: " << arg << "\n";
+            return 1;
+        }
+    }
+
+    // A stream from stdin is drawn as it arrives; files are paced at their fps
+    const bool from_stdin = input == "-";
+    const bool binary = ends_with(input, ".runeb");
+
+    std::unique_ptr<rune::runeb::Reader> runeb;
+    int manifest_cols = 0;
+    int manifest_fps = 0;
+
+    if (binary) {
+        runeb = std::make_unique<rune::runeb::Reader>(input);
+        manifest_cols = runeb->header().cols;
+        manifest_fps = runeb->header().fps;
+    } else if (!from_stdin) {
+        const size_t slash = input.find_last_of('/');
+        const std::string folder = slash == std::string::npos ? "." : input.substr(0, slash);
+        rune::jsonl::read_manifest(folder + "/manifest.json", manifest_cols, manifest_fps);
+    }
+
+    if (cols <= 0) cols = manifest_cols;
+    if (fps <= 0) fps = from_stdin ? 0 : (manifest_fps > 0 ? manifest_fps : 8);
+
+    if (cols <= 0) {
+        std::cerr << "column count unknown: pass --cols or keep manifest.json next to the frames\n";
+        return 1;
+    }
+
+    std::signal(SIGINT, on_interrupt);
+    std::signal(SIGTERM, on_interrupt);
+
+    rune::terminal::Renderer renderer;
+    rune::CellBuffer cells;
+    write_all(rune::terminal::Renderer::begin_sequence());
+
+    const auto period = fps > 0
+        ? std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / fps))
+        : std::chrono::steady_clock::duration::zero();
+    auto next_frame = std::chrono::steady_clock::now();
+
+    auto show = [&](const rune::CellBuffer& frame) {
+        if (period != std::chrono::steady_clock::duration::zero()) {
+            std::this_thread::sleep_until(next_frame);
+            // Late frames are shown right away rather than bunching up to catch up
+            next_frame = std::max(next_frame + period, std::chrono::steady_clock::now());
+        }
+        return write_all(renderer.render(frame));
+    };
+
+    int status = 0;
+    try {
+        do {
+            if (runeb) {
+                for (int i = 0; i < runeb->frame_count() && !interrupted; ++i) {
+                    runeb->read_frame(i, cells);
+                    if (!show(cells)) break;
+                }
+            } else {
+                std::ifstream file;
+                if (!from_stdin) {
+                    file.open(input);
+                    if (!file) {
+                        std::cerr << "failed to open input: " << input << "\n";
+                        status = 1;
+                        break;
+                    }
+                }
+
+                rune::jsonl::FrameReader reader(from_stdin ? std::cin : file, cols);
+                while (!interrupted && reader.next(cells)) {
+                    if (!show(cells)) break;
+                }
+            }
+        } while (loop && !from_stdin && !interrupted);
+    } catch (const std::exception& e) {
+        write_all(rune::terminal::Renderer::end_sequence());
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    write_all(rune::terminal::Renderer::end_sequence());
+    return status;
+}
@@ -0,0 +1,66 @@
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "rune/server.hpp"
+
+namespace {
+
+    std::atomic<bool> stop_requested { false };
+
+    void on_signal(int) {
+        stop_requested = true;
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    rune::server::ServerOptions options;
+    options.socket_path = "/tmp/rune.sock";
+    options.threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        if (arg == "--socket" && i + 1 < argc) {
+            options.socket_path = argv[++i];
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            options.threads = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (arg == "--queue" && i + 1 < argc) {
+            options.queue_limit = std::max(0, std::stoi(argv[++i]));
+        }
+        else if (arg == "--lut-bits" && i + 1 < argc) {
+            options.convert.lut_bits = std::stoi(argv[++i]);
+        }
+        else if (arg == "--cache-memory" && i + 1 < argc) {
+            options.convert.cache_memory_mb = std::stoi(argv[++i]);
+        }
+        else if (arg == "--log") {
+            options.log = true;
+        }
+        else {
+            std::cerr << "usage:\n"
+                      << "  rune_server [--socket path] [--threads N] [--queue N] [--lut-bits 1-8] [--cache-memory MB] [--log]\n";
+            return 1;
+        }
+    }
+
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+
+    try {
+        rune::server::Server server(options);
+        std::cerr << "listening on " << options.socket_path << " with " << options.threads << " threads\n";
+        server.run(stop_requested);
+        std::cerr << server.stats_json() << "\n";
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
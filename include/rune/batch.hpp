@@ -0,0 +1,44 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "rune/converter.hpp"
+#include "rune/ramp.hpp"
+
+namespace rune {
+
+    namespace batch {
+
+        // Outcome of one image in a batch
+        struct ImageResult {
+            std::string input;          // Source image path
+            std::string output_folder;  // Subfolder its frame files were written to
+            double milliseconds = 0.0;  // Wall time of the conversion
+            bool ok = false;
+            std::string error;          // Reason when !ok
+        };
+
+        // Expands a batch input into image paths, sorted:
+        //   a directory   -> every .png/.jpg/.jpeg/.bmp/.gif/.tga/.psd/.hdr/.pic/.pnm file in it
+        //   a glob        -> the paths it matches (any of * ? [)
+        //   anything else -> a list file with one path per line (blank lines and # comments skipped)
+        // Throws std::runtime_error if the input cannot be read.
+        std::vector<std::string> collect_inputs(const std::string& spec);
+
+        // Converts every image on one shared work-stealing pool of options.threads workers.
+        // Each image gets its own subfolder of output_folder named after the file (with a
+        // numeric suffix on name clashes); a failing image is reported, not fatal.
+        std::vector<ImageResult> convert_images(
+            const std::vector<std::string>& inputs,
+            int target_width,
+            const std::string& output_folder,
+            const rune::Ramp& ramp,
+            float threshold = 0.0f,
+            const rune::converter::ConvertOptions& options = {}
+        );
+
+        // Prints a per-image timing table and totals, and writes the same data to
+        // <output_folder>/batch.json
+        void write_summary(const std::vector<ImageResult>& results, const std::string& output_folder, double total_milliseconds);
+
+    } // namespace batch
+} // namespace rune
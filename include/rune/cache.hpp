@@ -0,0 +1,134 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "cell.hpp"
+#include "converter.hpp"
+#include "ramp.hpp"
+
+namespace rune {
+
+    // Content-addressed cache of converted frames.
+    //
+    // A frame is identified by a hash of its decoded pixels plus a hash of every
+    // setting that changes its cells (source size, width, ramp, threshold, lookup
+    // table bits). Entries live in two LRU tiers: memory, which serves repeated
+    // frames inside one run, and an optional folder on disk, which serves re-runs
+    // of the same source. Disk entries are one file per frame, named after the key:
+    //
+    //   offset  size  field
+    //   0       4     magic "RUNC"
+    //   4       2     version
+    //   6       2     reserved (zero)
+    //   8       8     pixel hash
+    //   16      8     settings hash
+    //   24      4     cols
+    //   28      4     rows
+    //   32      4     channels of the cell grid
+    //   36      4     glyph_count
+    //   40            glyph table: glyph_count x (u8 length, UTF-8 bytes)
+    //                 grid pixels (cols x rows x channels), then the planes
+    //                 h (u16 x cells) | glyph (u8 x cells) | s (u8 x cells) | l (u8 x cells)
+    //
+    // File modification times carry the LRU order between runs.
+    namespace cache {
+
+        constexpr uint16_t VERSION = 1;
+
+        // 64-bit hash of a byte range (the xxHash64 construction); several GB/s, so
+        // hashing a decoded frame costs a fraction of converting it
+        uint64_t hash_bytes(const void* data, size_t size, uint64_t seed = 0);
+
+        // Identifies one conversion
+        struct Key {
+            uint64_t pixels = 0;    // Hash of the decoded source pixels
+            uint64_t settings = 0;  // Hash of source geometry and conversion settings
+
+            bool operator==(const Key&) const = default;
+
+            // 32 lowercase hex digits, used as the disk file name
+            std::string hex() const;
+        };
+
+        struct KeyHash {
+            size_t operator()(const Key& key) const { return static_cast<size_t>(key.pixels ^ (key.settings * 0x9E3779B97F4A7C15ull)); }
+        };
+
+        // Builds the key for converting `image` to `target_width` columns
+        Key make_key(converter::ImageView image, int target_width, const rune::Ramp& ramp, float threshold, int lut_bits);
+
+        // Counters since the cache was created
+        struct Stats {
+            uint64_t memory_hits = 0;
+            uint64_t disk_hits = 0;
+            uint64_t misses = 0;
+            uint64_t evictions = 0;      // Entries dropped from either tier
+            uint64_t memory_bytes = 0;   // Current size of the memory tier
+            uint64_t disk_bytes = 0;     // Current size of the disk tier
+        };
+
+        // Two-tier LRU frame cache; safe to share between threads
+        class FrameCache {
+        public:
+            // memory_bytes = 0 disables the memory tier and an empty folder the disk tier.
+            // An existing folder is indexed, oldest entries first, and trimmed to disk_bytes.
+            FrameCache(size_t memory_bytes, const std::string& folder, uint64_t disk_bytes);
+
+            FrameCache(const FrameCache&) = delete;
+            FrameCache& operator=(const FrameCache&) = delete;
+
+            // Copies a cached frame into grid and cells, reusing their capacity; false on a miss.
+            // A disk hit is promoted to the memory tier.
+            bool lookup(const Key& key, converter::ImageBuffer& grid, rune::CellBuffer& cells);
+
+            // Stores a converted frame in every enabled tier, evicting least recently used entries
+            void insert(const Key& key, const converter::ImageBuffer& grid, const rune::CellBuffer& cells);
+
+            Stats stats() const;
+
+        private:
+            struct Entry {
+                Key key;
+                converter::ImageBuffer grid;
+                rune::CellBuffer cells;
+                size_t bytes;
+            };
+
+            struct DiskEntry {
+                Key key;
+                uint64_t bytes;
+            };
+
+            std::string path_for(const Key& key) const;
+            void insert_memory(const Key& key, const converter::ImageBuffer& grid, const rune::CellBuffer& cells);
+            void load_disk_index();
+
+            // Drops disk entries until the tier fits; returns the files to delete
+            std::vector<std::string> trim_disk();
+
+            mutable std::mutex mutex_;
+
+            size_t memory_limit_;
+            size_t memory_bytes_ = 0;
+            std::list<Entry> memory_;   // Most recently used first
+            std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> memory_index_;
+
+            std::string folder_;
+            uint64_t disk_limit_;
+            uint64_t disk_bytes_ = 0;
+            std::list<DiskEntry> disk_;  // Most recently used first
+            std::unordered_map<Key, std::list<DiskEntry>::iterator, KeyHash> disk_index_;
+
+            Stats stats_;
+        };
+
+        // Returns the process-wide cache for these settings, creating it on first use,
+        // so every job of a run (and every image of a batch) shares one set of tiers
+        std::shared_ptr<FrameCache> get_cache(size_t memory_bytes, const std::string& folder, uint64_t disk_bytes);
+
+    } // namespace cache
+} // namespace rune
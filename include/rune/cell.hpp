@@ -1,14 +1,39 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
 #include <string>
+#include <vector>
 
 namespace rune {
 
-    struct Cell {
-        std::string glyph;
-        float h;      // hue   [0–255]  → map to [0–360] in renderer
-        float s;      // sat   [0–255]
-        float l;      // lum [0–255]
+    // Planar (structure-of-arrays) storage for one frame of cells, laid out
+    // like the typed arrays the JS player decodes into. Colours are stored
+    // already quantized to the integers every writer emits.
+    struct CellBuffer {
+        int cols = 0;
+        int rows = 0;
+
+        std::vector<std::string> glyph_table; // ramp glyphs (UTF-8), indexed by `glyphs`
+
+        std::vector<uint8_t>  glyphs;  // glyph index into glyph_table
+        std::vector<uint16_t> h;       // hue        [0–360] degrees
+        std::vector<uint8_t>  s;       // saturation [0–100] %
+        std::vector<uint8_t>  l;       // lightness  [0–100] %
+
+        size_t size() const { return glyphs.size(); }
+
+        const std::string& glyph(size_t i) const { return glyph_table[glyphs[i]]; }
+
+        // Sizes every plane for cols x rows cells, reusing existing capacity
+        void resize(int new_cols, int new_rows) {
+            cols = new_cols;
+            rows = new_rows;
+            const size_t count = static_cast<size_t>(cols) * rows;
+            glyphs.resize(count);
+            h.resize(count);
+            s.resize(count);
+            l.resize(count);
+        }
     };
 
 } // namespace rune
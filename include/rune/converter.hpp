@@ -3,6 +3,8 @@
 #include <string>
 #include "cell.hpp"
 #include "ramp.hpp"
+#include "lut.hpp"
+#include "palette.hpp"
 #include <cstdint>
 #include <vector>
 
@@ -14,11 +16,17 @@
 #include <fstream>
 #include <filesystem>
 #include <iomanip>
+#include <cstdio>
+#include <cmath>
 #include <zlib.h>
 
 
 namespace rune {
 
+    namespace cache {
+        class FrameCache;
+    }
+
     namespace converter {
 
         // HSL color representation (Hue, Saturation, Lightness)
@@ -31,38 +39,182 @@ namespace rune {
         // Container for raw image pixel data
         struct ImageBuffer {
             std::vector<uint8_t> pixels; // Raw pixel data in RGB format
-            int width;                   // Image width in pixels
-            int height;                  // Image height in pixels
-            int channels;                // Number of color channels (typically 3 for RGB)
+            int width = 0;               // Image width in pixels
+            int height = 0;              // Image height in pixels
+            int channels = 0;            // Number of color channels (typically 3 for RGB)
+        };
+
+        // Non-owning view of packed pixels held by someone else. Converting through a
+        // view reads the caller's memory in place; an ImageBuffer converts implicitly.
+        struct ImageView {
+            const uint8_t* pixels = nullptr;  // First byte of the top row
+            int width = 0;                    // Image width in pixels
+            int height = 0;                   // Image height in pixels
+            int channels = 3;                 // Bytes per pixel (the first three are RGB)
+            size_t stride = 0;                // Bytes from one row to the next (0 = width * channels)
+
+            ImageView() = default;
+            ImageView(const uint8_t* pixels, int width, int height, int channels = 3, size_t stride = 0)
+                : pixels(pixels), width(width), height(height), channels(channels), stride(stride) {}
+            ImageView(const ImageBuffer& image_buffer)
+                : pixels(image_buffer.pixels.data()), width(image_buffer.width), height(image_buffer.height), channels(image_buffer.channels) {}
+
+            size_t row_bytes() const { return stride != 0 ? stride : static_cast<size_t>(width) * channels; }
+            const uint8_t* row(int y) const { return pixels + static_cast<size_t>(y) * row_bytes(); }
+        };
+
+        // Basic properties of a video stream as reported by ffprobe
+        struct VideoInfo {
+            int width;                   // Frame width in pixels
+            int height;                  // Frame height in pixels
+            int frame_count;             // Estimated frame count at the target fps (0 if unknown)
+        };
+
+        // Frame file formats a conversion can produce
+        enum class OutputFormat {
+            Jsonl,  // frames.jsonl + frames.jsonl.gz + frames.txt
+            Runeb   // frames.runeb indexed binary container
+        };
+
+        // Tuning knobs shared by the image and video conversion entry points
+        struct ConvertOptions {
+            int threads = 1;                            // Worker threads for video frames (1 = convert inline)
+            int lut_bits = 0;                           // Bits per channel of the colour lookup table (0 = exact per-pixel math)
+            OutputFormat format = OutputFormat::Jsonl;  // Which frame files to write
+            bool deflate_frames = false;                // Compress each .runeb frame payload with zlib
+            int keyframe_interval = 0;                  // > 1 writes delta frames between keyframes in the JSON outputs
+            int delta_tolerance = 0;                    // Colour change (degrees / percentage points) treated as unchanged
+            int seek_interval = 0;                      // > 0 starts a new gzip member every N frames and writes a seek index
+            int gzip_level = -1;                        // zlib level for frames.jsonl.gz (-1 = zlib default)
+            int gzip_threads = 1;                       // Threads deflating frames.jsonl.gz blocks (0 = same as threads)
+            int gzip_block_kb = 128;                    // Input block size per parallel deflate job, in KiB
+            bool quiet = false;                         // Skip the per-frame progress bar
+            int palette_size = 0;                       // > 0 quantizes HTML colours to a shared palette of CSS classes
+            int cache_memory_mb = 0;                    // > 0 keeps converted frames in memory, keyed by their pixels
+            std::string cache_dir = "";                 // Folder of the on-disk frame cache (empty = none)
+            int cache_disk_mb = 1024;                   // Size limit of the on-disk cache
+            double segment_seconds = 0.0;               // > 0 cuts video frame files into chunks listed in playlist.json
+            int io_queue_mb = 32;                       // > 0 hands a video's frame file writes to a background I/O thread with this much queued data
+            bool io_uring = true;                       // Let that thread use io_uring where the kernel supports it
+            bool fsync = false;                         // fsync each frame file as it is finished (segment end, job end); needs io_queue_mb > 0
         };
 
         // Represents a single frame converted to ASCII format
         struct AsciiFrame {
-            ImageBuffer image_buffer;         // Original image data
-            std::vector<rune::Cell> cells;    // ASCII cells with glyphs and colors
+            ImageBuffer image_buffer;         // Cell grid the frame was sampled from (one RGB pixel per cell)
+            rune::CellBuffer cells;           // ASCII cells with glyphs and colors
             std::string html = "";            // HTML representation of the frame
+            const rune::Ramp* ramp = nullptr; // Ramp the cells were mapped with; add_html takes its escaped glyphs
+        };
+
+        // Working memory of downsample_to_grid, kept between frames. The spans and
+        // weights depend only on the geometry, so they are rebuilt when it changes.
+        struct DownsampleScratch {
+            struct Span {
+                int first;        // First source pixel
+                int count;        // Source pixels touched
+                size_t weights;   // Offset of their weights
+            };
+
+            std::vector<Span> x_spans, y_spans;
+            std::vector<uint32_t> x_weights, y_weights;
+            std::vector<uint32_t> row_sums;   // Horizontal sums of one source row
+            std::vector<uint64_t> totals;     // Vertically weighted sums of one cell row
+            int width = 0, height = 0, cols = 0, rows = 0;
+        };
+
+        // Per-worker state for converting a run of frames. Together with a reused
+        // AsciiFrame it keeps every buffer's capacity, so once the first frame has
+        // been converted, later frames of the same size make no heap allocations.
+        struct FrameContext {
+            DownsampleScratch downsample;
+            cache::FrameCache* cache = nullptr;  // Consulted before converting, filled after (optional)
         };
 
         // Converts a single image frame to ASCII art
-        AsciiFrame convert_frame_to_ascii(const std::string& filename, int target_width, const rune::Ramp& ramp, float threshold = 0.0f);
+        AsciiFrame convert_frame_to_ascii(const std::string& filename, int target_width, const rune::Ramp& ramp, float threshold = 0.0f, const lut::ColorLut* lut = nullptr);
+
+        // Converts an already decoded frame to ASCII art
+        AsciiFrame convert_frame_to_ascii(const ImageBuffer& image_buffer, int target_width, const rune::Ramp& ramp, float threshold = 0.0f, const lut::ColorLut* lut = nullptr);
+
+        // Same, converting into `ascii_frame` and reusing its buffers and the context's scratch.
+        // With a cache in the context, a frame seen before is copied from it instead.
+        void convert_frame_to_ascii(ImageView image, int target_width, const rune::Ramp& ramp, float threshold, const lut::ColorLut* lut, FrameContext& context, AsciiFrame& ascii_frame);
 
-        // Generates HTML representation of an ASCII frame with color spans
-        void add_html(AsciiFrame& ascii_frame);
+        // Generates HTML representation of an ASCII frame with color spans (reusing ascii_frame.html)
+        // With a palette, spans carry its CSS classes and merge by palette entry instead of exact colour
+        void add_html(AsciiFrame& ascii_frame, const palette::Palette* palette = nullptr);
 
         // Converts a video file to ASCII frames and saves to output folder
-        void convert_video_to_ascii(const std::string& filename, int target_width, int target_fps, const std::string& output_folder, const rune::Ramp& ramp, float threshold = 0.0f);
+        // options.threads > 1 converts frames on a worker pool; output stays in frame order
+        void convert_video_to_ascii(const std::string& filename, int target_width, int target_fps, const std::string& output_folder, const rune::Ramp& ramp, float threshold = 0.0f, const ConvertOptions& options = {});
+
+        // Converts a video at several widths from one decode pass. With more than one width
+        // each rendition goes to output_folder/w<width>/ and output_folder/manifest.json lists them
+        void convert_video_to_ascii(const std::string& filename, const std::vector<int>& target_widths, int target_fps, const std::string& output_folder, const rune::Ramp& ramp, float threshold = 0.0f, const ConvertOptions& options = {});
+
+        // Converts a stream of packed RGB24 frames (e.g. ffmpeg rawvideo on a pipe) and saves to output folder
+        // expected_frames only drives the progress bar; the manifest records the frames actually read.
+        // Returns false, without reading the stream, if an output file cannot be opened
+        bool convert_raw_stream_to_ascii(std::FILE* in, int frame_width, int frame_height, int target_width, int target_fps, const std::string& output_folder, const rune::Ramp& ramp, float threshold = 0.0f, const ConvertOptions& options = {}, int expected_frames = 0);
+
+        // Multi-width form of the above, laid out like the multi-width convert_video_to_ascii
+        bool convert_raw_stream_to_ascii(std::FILE* in, int frame_width, int frame_height, const std::vector<int>& target_widths, int target_fps, const std::string& output_folder, const rune::Ramp& ramp, float threshold = 0.0f, const ConvertOptions& options = {}, int expected_frames = 0);
+
+        // Reads the next packed RGB24 frame sized by image_buffer's dimensions; false at end of stream
+        bool read_raw_frame(std::FILE* in, ImageBuffer& image_buffer);
+
+        // Starts ffmpeg decoding a video file to packed RGB24 frames at target_fps, each
+        // info.width x info.height; read them with read_raw_frame and close the pipe with
+        // pclose (non-zero means ffmpeg failed)
+        std::FILE* open_video_frames(const std::string& filename, int target_fps, const VideoInfo& info);
+
+        // Queries frame size (as decoded, after rotation metadata) and duration of a video file with ffprobe
+        VideoInfo probe_video(const std::string& filename, int target_fps);
 
         // Converts a single image to ASCII and saves to output folder
-        void convert_image_to_ascii(const std::string& filename, int target_width, const std::string& output_folder, const rune::Ramp& ramp, float threshold = 0.0f);
+        void convert_image_to_ascii(const std::string& filename, int target_width, const std::string& output_folder, const rune::Ramp& ramp, float threshold = 0.0f, const ConvertOptions& options = {});
 
         // Loads image from file and returns pixel data
         ImageBuffer load_image_pixels(const std::string& filename);
 
+        // Decodes an encoded image (PNG, JPEG, PPM, ...) held in memory to RGB pixels
+        ImageBuffer decode_image_pixels(const uint8_t* data, size_t size);
+
+        // Reads the dimensions of an encoded image in memory from its header, without
+        // decoding it; false if the format is not recognised
+        bool probe_image(const uint8_t* data, size_t size, int& width, int& height);
+
         // Resizes image to target width while maintaining aspect ratio
         ImageBuffer resize_image_pixels(const ImageBuffer& image_buffer, int target_width);
 
-        // Converts image pixels to ASCII cells with glyphs and colors
-        std::vector<rune::Cell> pixels_to_cells (const ImageBuffer& image_buffer, const rune::Ramp& ramp, float threshold = 0.0f);
+        // Rows of the cell grid for an image scaled to target_width; a glyph is about
+        // twice as tall as it is wide, so each cell covers two scaled pixel rows
+        int cell_rows(ImageView image, int target_width);
+
+        // Downsamples straight to a cols x rows grid, one RGB pixel per cell, with an
+        // integer area-averaging (box) filter: every cell is the exact average of the
+        // source area it covers, partial edge pixels weighted by their overlap
+        ImageBuffer downsample_to_grid(const ImageBuffer& image_buffer, int cols, int rows);
+
+        // Same, reading a view and writing into `grid`, reusing its pixels and the scratch buffers
+        void downsample_to_grid(ImageView image, int cols, int rows, ImageBuffer& grid, DownsampleScratch& scratch);
+
+        // Converts a cell grid (see downsample_to_grid) to ASCII cells with glyphs and colors
+        // A lookup table (see lut::get_lut) replaces the per-pixel colour math when given
+        rune::CellBuffer pixels_to_cells (const ImageBuffer& image_buffer, const rune::Ramp& ramp, float threshold = 0.0f, const lut::ColorLut* lut = nullptr);
+
+        // Same, writing into `cells`; its glyph table is only rebuilt when the ramp changes
+        void pixels_to_cells(const ImageBuffer& image_buffer, const rune::Ramp& ramp, float threshold, const lut::ColorLut* lut, rune::CellBuffer& cells);
+
+        // Splits a ramp into its UTF-8 glyphs
+        std::vector<std::string> split_glyphs(const rune::Ramp& ramp);
+
+        // Returns the shared lookup table for these settings, or null when options.lut_bits is 0
+        std::shared_ptr<const lut::ColorLut> lut_for(const rune::Ramp& ramp, float threshold, const ConvertOptions& options);
+
+        // Returns the shared frame cache for these options, or null when both of its tiers are off
+        std::shared_ptr<cache::FrameCache> cache_for(const ConvertOptions& options);
 
         // Converts RGB color values to HSL color space
         HSL rgb_to_hsl(int r, int g, int b);
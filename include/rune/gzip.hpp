@@ -0,0 +1,104 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <zlib.h>
+
+namespace rune {
+
+    namespace io {
+        class WriteQueue;
+    }
+
+    namespace writer {
+
+        // Gzip file writer built directly on deflate.
+        //
+        // Unlike gzopen/gzwrite it can end the current gzip member and start a new,
+        // independent one (start_member), and it reports exact compressed and
+        // uncompressed offsets. Concatenated members are still a single valid .gz
+        // file (RFC 1952), which browsers decode with Content-Encoding: gzip, while
+        // a reader can also start inflating at any member boundary.
+        //
+        // With more than one thread, each member is compressed pigz-style: the input
+        // is cut into blocks that are deflated in parallel, each primed with the last
+        // 32 KiB of the block before it, byte-aligned with a sync flush, and
+        // concatenated in order under one gzip header and a combined CRC-32. The
+        // result is still one ordinary deflate stream per member.
+        class GzipWriter {
+        public:
+            static constexpr size_t DEFAULT_BLOCK_SIZE = 128 * 1024;
+
+            GzipWriter();
+            ~GzipWriter();  // Closes the file; errors are only logged, call close() to get them
+
+            GzipWriter(const GzipWriter&) = delete;
+            GzipWriter& operator=(const GzipWriter&) = delete;
+
+            // Opens the file for writing; returns false if it cannot be created.
+            // threads > 1 compresses blocks of `block_size` input bytes in parallel.
+            // With a queue, compressed bytes are handed to its I/O thread instead of
+            // being written here.
+            bool open(
+                const std::string& path,
+                int level = Z_DEFAULT_COMPRESSION,
+                int threads = 1,
+                size_t block_size = DEFAULT_BLOCK_SIZE,
+                io::WriteQueue* queue = nullptr
+            );
+
+            bool is_open() const { return file_ != nullptr || queue_file_ >= 0; }
+
+            void write(const void* data, size_t size);
+            void write(std::string_view data) { write(data.data(), data.size()); }
+
+            // Finishes the current member; the next write begins a new one
+            void start_member();
+
+            // Bytes written to the file so far (exact right after start_member)
+            uint64_t compressed_offset() const { return compressed_; }
+
+            // Bytes fed to write() so far
+            uint64_t uncompressed_offset() const { return uncompressed_; }
+
+            // Finishes the last member and closes the file; throws std::runtime_error if
+            // any write failed (the writer is closed either way)
+            void close();
+
+        private:
+            struct Block;
+            struct BlockPipeline;
+
+            void deflate_input(const void* data, size_t size, int flush);
+
+            void begin_parallel_member();
+            void submit_block(bool last);
+            void finish_parallel_member();
+            void write_file(const void* data, size_t size);
+
+            std::FILE* file_ = nullptr;
+            io::WriteQueue* queue_ = nullptr;
+            int queue_file_ = -1;
+            z_stream stream_ {};
+            bool member_open_ = false;
+            int level_ = Z_DEFAULT_COMPRESSION;
+            uint64_t compressed_ = 0;
+            uint64_t uncompressed_ = 0;
+            std::vector<unsigned char> out_;
+
+            // Parallel mode
+            int threads_ = 1;
+            size_t block_size_ = DEFAULT_BLOCK_SIZE;
+            std::unique_ptr<BlockPipeline> pipeline_;  // Started with the first member, kept until close()
+            std::vector<unsigned char> pending_;     // Input not yet handed to a worker
+            std::vector<unsigned char> dictionary_;  // Last 32 KiB of input already submitted
+            uLong member_crc_ = 0;
+            uint64_t member_size_ = 0;
+        };
+
+    } // namespace writer
+} // namespace rune
@@ -0,0 +1,112 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace rune {
+
+    namespace io {
+
+        // Append-mostly output files written by one background thread.
+        //
+        // write() copies into a per-file batch buffer (page aligned, batch_bytes long)
+        // and returns; a full batch goes on a bounded queue that the I/O thread drains,
+        // so the converting thread only waits on the disk when max_queued_bytes are
+        // already in flight. The I/O thread submits every queued batch at once through
+        // io_uring where the kernel allows it, and otherwise with pwritev, merging
+        // batches that continue each other. Files are only fsynced as they are closed,
+        // and only with Options::sync_on_close; callers close at their checkpoints.
+        //
+        // Write errors are kept per file and reported by close().
+        class WriteQueue {
+        public:
+            struct Options {
+                size_t batch_bytes = 1 << 20;          // Size of one write (rounded up to a page)
+                size_t max_queued_bytes = 32u << 20;   // Queued data before write() waits
+                bool io_uring = true;                  // false forces the pwritev fallback
+                bool sync_on_close = false;            // fsync each file before closing it
+            };
+
+            // Totals since the queue was created
+            struct Stats {
+                uint64_t bytes = 0;     // Bytes written to files
+                uint64_t writes = 0;    // Write requests issued (one per io_uring entry or pwritev call)
+                uint64_t rounds = 0;    // Times the I/O thread woke up to drain the queue
+                uint64_t stalls = 0;    // Times write() waited for the queue to drain
+                uint64_t syncs = 0;     // fsync calls
+            };
+
+            WriteQueue();
+            explicit WriteQueue(const Options& options);
+            ~WriteQueue();  // Finishes and closes every open file
+
+            WriteQueue(const WriteQueue&) = delete;
+            WriteQueue& operator=(const WriteQueue&) = delete;
+
+            // Opens a file for writing at its end (truncating it first if asked) and
+            // returns its handle, or -1 if it cannot be opened
+            int open(const std::string& path, bool truncate = false);
+
+            // Appends to the file; waits only while the queue is full
+            void write(int file, const void* data, size_t size);
+            void write(int file, std::string_view data) { write(file, data.data(), data.size()); }
+
+            // Overwrites bytes already appended, after every earlier write of the file
+            // (e.g. a header patched in once the file is complete)
+            void write_at(int file, uint64_t offset, const void* data, size_t size);
+
+            // Bytes appended to the file so far
+            uint64_t size(int file) const;
+
+            // Writes what is buffered, syncs if sync_on_close is set and closes the file.
+            // Waits until that is done; false if any write to the file failed.
+            bool close(int file);
+
+            // "io_uring" or "pwritev"
+            const char* backend() const;
+
+            Stats stats() const;
+
+        private:
+            struct Buffer;
+            struct File;
+            struct Op;
+            struct Ring;
+
+            void submit(std::unique_lock<std::mutex>& lock, Op op);
+            void queue_pending(std::unique_lock<std::mutex>& lock, File& file);
+            std::unique_ptr<Buffer> take_buffer();
+            void run();
+            void write_batch(std::vector<Op>& batch);
+            void write_fallback(std::vector<Op>& batch, size_t first);
+            void finish(Op& op);
+
+            Options options_;
+
+            mutable std::mutex mutex_;
+            std::condition_variable work_cv_;   // I/O thread: ops queued or stopping
+            std::condition_variable done_cv_;   // Producers: queue drained or a file closed
+            std::vector<Op> ops_;
+            std::vector<Op> round_;             // I/O thread: ops taken from ops_ this round
+            std::vector<Op> batch_;             // I/O thread: appends written together
+            std::vector<std::unique_ptr<File>> files_;
+            std::vector<std::unique_ptr<Buffer>> free_;
+            size_t queue_buffers_ = 0;          // Buffers a full queue holds
+            size_t open_files_ = 0;             // Files opened and not yet closed
+            size_t queued_bytes_ = 0;
+            bool stopping_ = false;
+            bool uring_ = false;          // Whether ring_ is still in use, for backend()
+            Stats stats_;
+
+            std::unique_ptr<Ring> ring_;  // Null when io_uring is unavailable; used by the I/O thread only
+            std::thread thread_;
+        };
+
+    } // namespace io
+} // namespace rune
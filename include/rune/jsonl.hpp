@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "cell.hpp"
+
+namespace rune {
+
+    namespace jsonl {
+
+        // Reads frames back from frames.jsonl (or a --stream feed).
+        //
+        // Handles both line kinds the writers produce: full frames
+        // {"cells":[{"g":..,"h":..,"s":..,"l":..},...]} and delta frames
+        // {"d":[{"i":N,"cells":[...]},...]}, which are applied on top of the previous
+        // frame. Glyphs are decoded to UTF-8 and interned into the buffer's glyph table.
+        // Lines hold no geometry, so the column count comes from the caller (manifest.json).
+        class FrameReader {
+        public:
+            FrameReader(std::istream& in, int cols);
+
+            // Decodes the next frame into `cells`; false at end of input.
+            // Throws std::runtime_error on a malformed line.
+            bool next(CellBuffer& cells);
+
+        private:
+            void parse_cells(std::string_view& p, CellBuffer& cells, size_t first, bool append);
+            uint8_t intern(const std::string& glyph, CellBuffer& cells);
+
+            std::istream& in_;
+            int cols_;
+            std::string line_;
+            std::string glyph_;
+            std::unordered_map<std::string, uint8_t> glyph_index_;
+            bool have_frame_ = false;
+        };
+
+        // Reads "cols" and "fps" from a manifest.json; missing fields are left untouched
+        void read_manifest(const std::string& path, int& cols, int& fps);
+
+    } // namespace jsonl
+} // namespace rune
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+
+namespace rune {
+
+    namespace kernel {
+
+        // Instruction sets the row kernels are compiled for
+        enum class Isa {
+            Scalar,
+            SSE41,
+            AVX2
+        };
+
+        // Best instruction set supported by this CPU (checked once via CPUID)
+        Isa detect_isa();
+
+        // Human readable name of an instruction set ("scalar", "sse4.1", "avx2")
+        const char* isa_name(Isa isa);
+
+        // Maps `count` RGB pixels, `stride` bytes apart, to glyph indices and quantized colour:
+        // hue in whole degrees, saturation and thresholded lightness in whole percent.
+        // Uses the best instruction set available; matches rgb_to_hsl after quantization.
+        void map_row(
+            const uint8_t* pixels,
+            int count,
+            int stride,
+            float threshold,
+            int last_glyph,
+            uint8_t* glyphs,
+            uint16_t* h,
+            uint8_t* s,
+            uint8_t* l
+        );
+
+        // Same as above with an explicit instruction set; unsupported sets fall back to scalar
+        void map_row(
+            Isa isa,
+            const uint8_t* pixels,
+            int count,
+            int stride,
+            float threshold,
+            int last_glyph,
+            uint8_t* glyphs,
+            uint16_t* h,
+            uint8_t* s,
+            uint8_t* l
+        );
+
+    } // namespace kernel
+} // namespace rune
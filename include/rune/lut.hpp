@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace rune {
+
+    namespace lut {
+
+        // Precomputed output for one RGB bucket: glyph index and quantized colour
+        struct LutEntry {
+            uint16_t h;      // hue        [0–360] degrees
+            uint8_t glyph;   // glyph index into the ramp
+            uint8_t s;       // saturation [0–100] %
+            uint8_t l;       // lightness  [0–100] % (threshold applied)
+        };
+
+        // RGB -> cell lookup table for one (glyph count, threshold) pair.
+        //
+        // With `bits` per channel the table has 2^(3*bits) entries and each entry is
+        // evaluated at the centre of its bucket, so a channel is off by at most
+        // 2^(7-bits) levels. At 8 bits (96 MB) the table is exact. At 6 or 7 bits
+        // lightness is within 1% and the glyph within one ramp step of the exact
+        // path (pixels whose bucket straddles the threshold may flip to white).
+        // Hue and saturation are unbounded for near-grey and near-black pixels,
+        // where both are poorly defined anyway.
+        class ColorLut {
+        public:
+            ColorLut(int bits, float threshold, int last_glyph);
+
+            int bits() const { return bits_; }
+
+            const LutEntry& lookup(uint8_t r, uint8_t g, uint8_t b) const {
+                const int shift = 8 - bits_;
+                const size_t idx = (static_cast<size_t>(r >> shift) << (2 * bits_))
+                                 | (static_cast<size_t>(g >> shift) << bits_)
+                                 | static_cast<size_t>(b >> shift);
+                return entries_[idx];
+            }
+
+            // Same contract as kernel::map_row, one table load per pixel
+            void map_row(
+                const uint8_t* pixels,
+                int count,
+                int stride,
+                uint8_t* glyphs,
+                uint16_t* h,
+                uint8_t* s,
+                uint8_t* l
+            ) const;
+
+        private:
+            int bits_;
+            std::vector<LutEntry> entries_;
+        };
+
+        // Returns the table for (glyph count, threshold, bits), building it on first use.
+        // Tables are cached and shared between threads, so repeated jobs with the same
+        // settings skip the build entirely. The cache keeps up to 256 MB of tables and
+        // drops the least recently used first; a dropped table lives on while a job
+        // holds it. Builds run outside the cache lock, one per setting at a time.
+        std::shared_ptr<const ColorLut> get_lut(int glyph_count, float threshold, int bits);
+
+    } // namespace lut
+} // namespace rune
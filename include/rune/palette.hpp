@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace rune {
+
+    namespace palette {
+
+        // Fixed colour palette for the HTML output, shared by every frame of a video.
+        //
+        // HSL space is cut into a regular grid sized to at most `size` entries:
+        // `lightness_levels` steps that always include 0% and 100%, a set of greys
+        // (saturation 0, where hue is meaningless) and `hue_levels` x chromatic
+        // saturation steps. The grid depends only on `size`, so it is built in one
+        // pass before the first frame and every worker can map colours without
+        // coordination. Each entry becomes a short CSS class ("p" + base-36 index).
+        class Palette {
+        public:
+            // size is clamped to at least 4
+            explicit Palette(int size);
+
+            // Entries actually used by the grid (<= the requested size)
+            int size() const { return static_cast<int>(classes_.size()); }
+
+            // Palette entry for a cell colour (degrees, %, %)
+            int index(int h, int s, int l) const {
+                const int lq = (l * (lightness_levels_ - 1) + 50) / 100;
+                const int sq = (s * (saturation_levels_ - 1) + 50) / 100;
+                if (sq == 0) {
+                    return lq;
+                }
+                const int hq = ((h % 360) * hue_levels_ + 180) / 360 % hue_levels_;
+                return lightness_levels_ + ((hq * (saturation_levels_ - 1) + (sq - 1)) * lightness_levels_ + lq);
+            }
+
+            const std::string& css_class(int index) const { return classes_[index]; }
+
+            // One rule per entry: .p1a{color:hsl(120,50%,40%)}
+            void write_stylesheet(std::ostream& out) const;
+
+        private:
+            int hue_levels_;
+            int saturation_levels_;
+            int lightness_levels_;
+            std::vector<std::string> classes_;
+            std::vector<std::string> colours_;
+        };
+
+    } // namespace palette
+} // namespace rune
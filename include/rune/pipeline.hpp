@@ -0,0 +1,187 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace rune {
+
+    namespace pipeline {
+
+        // Runs one work function on a pool of worker threads and hands the results
+        // to a sink strictly in submission order (the reorder stage).
+        //
+        // Jobs live in a fixed ring of `capacity` slots, each holding an input and an
+        // output, so at most `capacity` jobs are queued, running or waiting to be
+        // written; submit() blocks once every slot is taken, which caps memory no
+        // matter how far the producer runs ahead of the sink. Slots are reused in
+        // turn, with their buffers: submit() swaps the input into its slot and hands
+        // back the one left there by an earlier job, and work() fills the slot's
+        // previous output in place, so a warm pipeline moves data without allocating.
+        template <typename In, typename Out>
+        class OrderedPipeline {
+        public:
+            using Work = std::function<void(In&, Out&)>;
+            using Sink = std::function<void(Out&)>;
+
+            OrderedPipeline(int threads, std::size_t capacity, Work work, Sink sink)
+                : capacity_(capacity == 0 ? 1 : capacity), slots_(capacity_), work_(std::move(work)), sink_(std::move(sink)) {
+                if (threads < 1) threads = 1;
+
+                workers_.reserve(threads);
+                for (int i = 0; i < threads; ++i) {
+                    workers_.emplace_back([this] { worker_loop(); });
+                }
+                writer_ = std::thread([this] { writer_loop(); });
+            }
+
+            OrderedPipeline(const OrderedPipeline&) = delete;
+            OrderedPipeline& operator=(const OrderedPipeline&) = delete;
+
+            ~OrderedPipeline() {
+                try {
+                    finish();
+                } catch (...) {
+                    // finish() must be called explicitly to observe errors
+                }
+            }
+
+            // Queues a job on `input`, blocking while every slot is taken. `input` comes
+            // back holding the input of the job that used the slot before (or a default
+            // In), whose storage the caller may reuse.
+            // Rethrows the first error raised by a job or by the sink.
+            void submit(In& input) {
+                std::unique_lock<std::mutex> lock(mutex_);
+                space_cv_.wait(lock, [this] { return error_ || submitted_ - written_ < capacity_; });
+                if (error_) std::rethrow_exception(error_);
+
+                Slot& slot = slots_[submitted_ % capacity_];
+                using std::swap;
+                swap(slot.input, input);
+                slot.done = false;
+                submitted_++;
+                jobs_cv_.notify_one();
+            }
+
+            // Waits for every job submitted so far to reach the sink; the pipeline stays
+            // open for more. Rethrows the first error raised by a job or by the sink.
+            void drain() {
+                std::unique_lock<std::mutex> lock(mutex_);
+                space_cv_.wait(lock, [this] { return error_ || written_ == submitted_; });
+                if (error_) std::rethrow_exception(error_);
+            }
+
+            // Waits for every submitted job to reach the sink, then joins all threads.
+            void finish() {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (closed_) {
+                        if (error_) std::rethrow_exception(error_);
+                        return;
+                    }
+                    closed_ = true;
+                }
+                jobs_cv_.notify_all();
+                results_cv_.notify_all();
+
+                for (auto& worker : workers_) worker.join();
+                writer_.join();
+
+                if (error_) std::rethrow_exception(error_);
+            }
+
+        private:
+            struct Slot {
+                In input;
+                Out output;
+                bool done = false;  // output is ready for the sink
+            };
+
+            void fail(std::exception_ptr error) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!error_) error_ = error;
+                jobs_cv_.notify_all();
+                results_cv_.notify_all();
+                space_cv_.notify_all();
+            }
+
+            void worker_loop() {
+                for (;;) {
+                    std::size_t sequence;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex_);
+                        jobs_cv_.wait(lock, [this] { return error_ || closed_ || started_ < submitted_; });
+                        if (error_ || started_ == submitted_) return;
+                        sequence = started_++;
+                    }
+
+                    // The slot is not reused before the sink has taken this job's output
+                    Slot& slot = slots_[sequence % capacity_];
+                    try {
+                        work_(slot.input, slot.output);
+                    } catch (...) {
+                        fail(std::current_exception());
+                        return;
+                    }
+
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    slot.done = true;
+                    results_cv_.notify_one();
+                }
+            }
+
+            void writer_loop() {
+                for (;;) {
+                    Slot* slot;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex_);
+                        results_cv_.wait(lock, [this] {
+                            return error_
+                                || (written_ < submitted_ && slots_[written_ % capacity_].done)
+                                || (closed_ && written_ == submitted_);
+                        });
+                        if (error_ || written_ == submitted_) return;
+
+                        slot = &slots_[written_ % capacity_];
+                    }
+
+                    try {
+                        sink_(slot->output);
+                    } catch (...) {
+                        fail(std::current_exception());
+                        return;
+                    }
+
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    written_++;
+                    space_cv_.notify_all();
+                }
+            }
+
+            const std::size_t capacity_;
+            std::vector<Slot> slots_;
+            Work work_;
+            Sink sink_;
+
+            std::mutex mutex_;
+            std::condition_variable jobs_cv_;
+            std::condition_variable results_cv_;
+            std::condition_variable space_cv_;
+
+            std::size_t submitted_ = 0;  // Jobs handed to submit()
+            std::size_t started_ = 0;    // Jobs taken by a worker
+            std::size_t written_ = 0;    // Jobs whose output reached the sink
+            bool closed_ = false;
+            std::exception_ptr error_;
+
+            std::vector<std::thread> workers_;
+            std::thread writer_;
+        };
+
+    } // namespace pipeline
+} // namespace rune
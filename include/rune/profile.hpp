@@ -0,0 +1,108 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace rune {
+
+    namespace profile {
+
+        // Pipeline stages timed by --profile
+        enum class Stage {
+            Input,       // Waiting on ffmpeg / the raw input stream for a frame
+            Decode,      // Decoding an image file (stb_image)
+            Cache,       // Hashing frames and frame cache lookups and inserts
+            Resize,      // Downsampling to the cell grid
+            Cells,       // Mapping pixels to glyphs and colours
+            Html,        // Building the HTML spans
+            Serialize,   // Encoding JSON lines
+            WriteJsonl,  // frames.jsonl
+            WriteGzip,   // frames.jsonl.gz (deflate itself, or handing blocks to the gzip workers)
+            WriteHtml,   // frames.txt
+            WriteRuneb,  // frames.runeb (including per-frame deflate)
+            Count
+        };
+
+        // Short name used in reports ("input", "decode", "resize", ...)
+        const char* stage_name(Stage stage);
+
+        // Collects per-stage wall and CPU time and per-frame latency for one run.
+        // Thread-safe: stages may be timed from any worker at once.
+        class Profiler {
+        public:
+            Profiler();
+
+            // Wall-clock bounds of the run, used for overall frames per second
+            void start();
+            void stop();
+
+            void add(Stage stage, uint64_t wall_ns, uint64_t cpu_ns);
+
+            // End-to-end time of one frame, from its input being available to its last write
+            void frame_done(double latency_ms);
+
+            // Stage table on `out`, one line per stage that ran
+            void print_stages(std::ostream& out) const;
+
+            // Writes the JSON run report: frames, fps, latency percentiles, per-stage times,
+            // bytes per output format found under output_folder and peak RSS
+            void write_report(std::ostream& out, const std::string& output_folder) const;
+
+        private:
+            struct Totals {
+                std::atomic<uint64_t> wall_ns { 0 };
+                std::atomic<uint64_t> cpu_ns { 0 };
+                std::atomic<uint64_t> calls { 0 };
+            };
+
+            std::array<Totals, static_cast<size_t>(Stage::Count)> stages_;
+
+            mutable std::mutex latency_mutex_;
+            std::vector<double> latencies_ms_;
+
+            std::chrono::steady_clock::time_point started_;
+            std::chrono::steady_clock::time_point stopped_;
+        };
+
+        // The profiler stage timers report to, or null when profiling is off
+        Profiler* current();
+
+        // Installs `profiler` as current for the lifetime of the guard
+        class Session {
+        public:
+            explicit Session(Profiler* profiler);
+            ~Session();
+
+            Session(const Session&) = delete;
+            Session& operator=(const Session&) = delete;
+
+        private:
+            Profiler* previous_;
+        };
+
+        // Times the enclosing scope as `stage`; costs one atomic load when profiling is off
+        class Timer {
+        public:
+            explicit Timer(Stage stage);
+            ~Timer();
+
+            Timer(const Timer&) = delete;
+            Timer& operator=(const Timer&) = delete;
+
+        private:
+            Profiler* profiler_;
+            Stage stage_;
+            uint64_t wall_start_ = 0;
+            uint64_t cpu_start_ = 0;
+        };
+
+        // Peak resident set size of this process in KiB
+        long peak_rss_kb();
+
+    } // namespace profile
+} // namespace rune
@@ -1,11 +1,181 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
 #include <string_view>
 
 namespace rune {
 
-struct Ramp {
-    std::string_view chars;
-};
+    // One glyph in one output encoding, stored inline so a compiled ramp is a
+    // literal type and the built-in ramps are compiled by the compiler
+    struct EncodedGlyph {
+        char bytes[15] = {};
+        uint8_t size = 0;
+
+        constexpr std::string_view view() const { return { bytes, size }; }
+
+        constexpr void push(char c) { bytes[size++] = c; }
+    };
+
+    namespace glyph_encoding {
+
+        // Byte length of the UTF-8 sequence starting with `c`
+        constexpr size_t length(unsigned char c) {
+            if ((c & 0x80) == 0) return 1;     // ASCII
+            if ((c & 0xE0) == 0xC0) return 2;  // 2-byte UTF-8
+            if ((c & 0xF0) == 0xE0) return 3;  // 3-byte UTF-8
+            if ((c & 0xF8) == 0xF0) return 4;  // 4-byte UTF-8
+            return 1;
+        }
+
+        // Contents of a JSON string: the escapes JSON requires, ASCII as is, and
+        // anything else as \uXXXX of its code point (a UTF-16 surrogate pair above U+FFFF)
+        constexpr EncodedGlyph json(std::string_view glyph) {
+            EncodedGlyph out;
+            auto escape = [&out](char c) { out.push('\\'); out.push(c); };
+
+            if (glyph == "\\") {
+                escape('\\');
+            } else if (glyph == "\"") {
+                escape('"');
+            } else if (glyph == "\b") {
+                escape('b');
+            } else if (glyph == "\f") {
+                escape('f');
+            } else if (glyph == "\n") {
+                escape('n');
+            } else if (glyph == "\r") {
+                escape('r');
+            } else if (glyph == "\t") {
+                escape('t');
+            } else if (glyph.size() == 1 && static_cast<unsigned char>(glyph[0]) < 128) {
+                out.push(glyph[0]);
+            } else {
+                auto byte = [&glyph](size_t i) { return static_cast<uint32_t>(static_cast<unsigned char>(glyph[i])); };
+                uint32_t codepoint = 0;
+
+                if ((byte(0) & 0x80) == 0) {
+                    codepoint = byte(0);
+                } else if ((byte(0) & 0xE0) == 0xC0 && glyph.size() >= 2) {
+                    codepoint = ((byte(0) & 0x1F) << 6) | (byte(1) & 0x3F);
+                } else if ((byte(0) & 0xF0) == 0xE0 && glyph.size() >= 3) {
+                    codepoint = ((byte(0) & 0x0F) << 12) | ((byte(1) & 0x3F) << 6) | (byte(2) & 0x3F);
+                } else if ((byte(0) & 0xF8) == 0xF0 && glyph.size() >= 4) {
+                    codepoint = ((byte(0) & 0x07) << 18) | ((byte(1) & 0x3F) << 12) | ((byte(2) & 0x3F) << 6) | (byte(3) & 0x3F);
+                }
+
+                // Lowercase hex, four digits (printf's "\\u%04x")
+                auto unit = [&](uint32_t code_unit) {
+                    escape('u');
+                    for (int d = 3; d >= 0; --d) {
+                        out.push("0123456789abcdef"[(code_unit >> (4 * d)) & 0xF]);
+                    }
+                };
+
+                if (codepoint > 0xFFFF) {
+                    codepoint -= 0x10000;
+                    unit(0xD800 | (codepoint >> 10));
+                    unit(0xDC00 | (codepoint & 0x3FF));
+                } else {
+                    unit(codepoint);
+                }
+            }
+            return out;
+        }
+
+        // Text for an HTML frame line. Backslashes are escaped too, because a
+        // frames.txt line uses a literal "\n" to separate rows.
+        constexpr EncodedGlyph html(std::string_view glyph) {
+            EncodedGlyph out;
+            auto put = [&out](std::string_view text) { for (char c : text) out.push(c); };
+
+            if (glyph == "&") {
+                put("&amp;");
+            } else if (glyph == "<") {
+                put("&lt;");
+            } else if (glyph == ">") {
+                put("&gt;");
+            } else if (glyph == "\\") {
+                put("&#92;");
+            } else {
+                put(glyph);
+            }
+            return out;
+        }
+
+        // Bytes for a terminal: the UTF-8 glyph, with control characters (which
+        // could start escape sequences or move the cursor) drawn as a space
+        constexpr EncodedGlyph ansi(std::string_view glyph) {
+            EncodedGlyph out;
+            const unsigned char first = static_cast<unsigned char>(glyph[0]);
+            if (glyph.size() == 1 && (first < 0x20 || first == 0x7F)) {
+                out.push(' ');
+                return out;
+            }
+            for (char c : glyph) out.push(c);
+            return out;
+        }
+
+    } // namespace glyph_encoding
+
+    // A ramp parsed once into everything the hot loop needs: the glyph count and
+    // every glyph already encoded for each output, so writing a cell is a table
+    // lookup plus a memcpy. The built-in ramps are compiled at compile time; a
+    // custom ramp once, when it is constructed.
+    class CompiledRamp {
+    public:
+        static constexpr int MAX_GLYPHS = 256;  // Glyph indices are one byte
+
+        constexpr CompiledRamp() = default;
+
+        constexpr CompiledRamp(std::string_view ramp_chars) : chars(ramp_chars) {
+            size_t i = 0;
+            while (i < chars.size()) {
+                if (count_ == MAX_GLYPHS) {
+                    throw std::runtime_error("ramp has more than 256 glyphs");
+                }
+
+                const size_t char_len = glyph_encoding::length(static_cast<unsigned char>(chars[i]));
+                const std::string_view glyph = chars.substr(i, char_len);
+
+                Glyph& g = glyphs_[count_++];
+                for (char c : glyph) g.utf8.push(c);
+                g.json = glyph_encoding::json(glyph);
+                g.html = glyph_encoding::html(glyph);
+                g.ansi = glyph_encoding::ansi(glyph);
+
+                if (g.json.size > max_json_) max_json_ = g.json.size;
+                if (g.html.size > max_html_) max_html_ = g.html.size;
+                i += char_len;
+            }
+        }
+
+        std::string_view chars;  // The ramp as given, darkest glyph first
+
+        constexpr int size() const { return count_; }
+
+        constexpr std::string_view utf8(int glyph) const { return glyphs_[glyph].utf8.view(); }
+        constexpr std::string_view json(int glyph) const { return glyphs_[glyph].json.view(); }
+        constexpr std::string_view html(int glyph) const { return glyphs_[glyph].html.view(); }
+        constexpr std::string_view ansi(int glyph) const { return glyphs_[glyph].ansi.view(); }
+
+        // Longest encoding of any glyph, for sizing output buffers
+        constexpr size_t max_json() const { return max_json_; }
+        constexpr size_t max_html() const { return max_html_; }
+
+    private:
+        struct Glyph {
+            EncodedGlyph utf8, json, html, ansi;
+        };
+
+        Glyph glyphs_[MAX_GLYPHS] = {};
+        int count_ = 0;
+        uint8_t max_json_ = 0;
+        uint8_t max_html_ = 0;
+    };
+
+    // Every API takes the compiled form
+    using Ramp = CompiledRamp;
 
     namespace ramps {
 
@@ -0,0 +1,119 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "cell.hpp"
+
+namespace rune {
+
+    namespace io {
+        class WriteQueue;
+    }
+
+    // .runeb — indexed binary frame container (version 1, little-endian)
+    //
+    //   offset  size  field
+    //   0       4     magic "RUNB"
+    //   4       2     version
+    //   6       2     flags (bit 0: frame payloads are zlib-compressed)
+    //   8       4     cols
+    //   12      4     rows
+    //   16      4     fps
+    //   20      4     frame_count
+    //   24      8     index_offset
+    //   32      4     glyph_count
+    //   36      28    reserved (zero)
+    //   64            glyph table: glyph_count x (u8 length, UTF-8 bytes)
+    //
+    // Every frame payload starts on an 8-byte boundary and holds the planes
+    //   h (u16 x cells) | glyph (u8 x cells) | s (u8 x cells) | l (u8 x cells)
+    // so an uncompressed file can be memory-mapped and each plane wrapped in a
+    // typed array without copying. The index at index_offset holds
+    // frame_count x (u64 offset, u32 stored size, u32 raw size).
+    namespace runeb {
+
+        constexpr uint16_t VERSION = 1;
+        constexpr uint16_t FLAG_DEFLATE = 1 << 0;
+        constexpr uint32_t HEADER_SIZE = 64;
+
+        // Decoded file header
+        struct Header {
+            uint16_t version = VERSION;
+            uint16_t flags = 0;
+            int cols = 0;
+            int rows = 0;
+            int fps = 0;
+            int frame_count = 0;
+            uint64_t index_offset = 0;
+            std::vector<std::string> glyph_table;
+        };
+
+        // Location of one frame payload in the file
+        struct IndexEntry {
+            uint64_t offset;       // Byte offset of the payload
+            uint32_t stored_size;  // Bytes on disk (compressed size if FLAG_DEFLATE)
+            uint32_t raw_size;     // Bytes of the planar payload (5 per cell)
+        };
+
+        // Streams frames into a .runeb file; the header and index are finalized on close()
+        class Writer {
+        public:
+            Writer() = default;
+            ~Writer();  // Closes the file; errors are only logged, call close() to get them
+
+            Writer(const Writer&) = delete;
+            Writer& operator=(const Writer&) = delete;
+
+            // Opens the file for writing; returns false if it cannot be created.
+            // With a queue, the bytes are written by its I/O thread.
+            bool open(const std::string& path, int fps, bool deflate = false, int level = 6, io::WriteQueue* queue = nullptr);
+
+            // Appends a frame; the first frame fixes cols, rows and the glyph table.
+            // Throws std::runtime_error once a write has failed
+            void write_frame(const CellBuffer& cells);
+
+            // Writes the index and patches the header; throws std::runtime_error if any
+            // write to the file failed
+            void close();
+
+            bool is_open() const { return out_.is_open() || queue_file_ >= 0; }
+            int frame_count() const { return static_cast<int>(index_.size()); }
+
+        private:
+            void put(const void* data, size_t size);
+
+            std::ofstream out_;
+            io::WriteQueue* queue_ = nullptr;
+            int queue_file_ = -1;
+            Header header_;
+            std::vector<IndexEntry> index_;
+            std::vector<uint8_t> planes_;
+            std::vector<uint8_t> compressed_;
+            uint64_t offset_ = 0;
+            int level_ = 6;
+        };
+
+        // Random-access reader for .runeb files
+        class Reader {
+        public:
+            // Opens the file and loads header and index; throws std::runtime_error on a bad file
+            explicit Reader(const std::string& path);
+
+            const Header& header() const { return header_; }
+            int frame_count() const { return header_.frame_count; }
+            const IndexEntry& entry(int frame) const { return index_.at(frame); }
+
+            // Decodes one frame into `cells`, reusing its capacity
+            void read_frame(int frame, CellBuffer& cells);
+
+        private:
+            std::ifstream in_;
+            Header header_;
+            std::vector<IndexEntry> index_;
+            std::vector<uint8_t> stored_;
+            std::vector<uint8_t> planes_;
+        };
+
+    } // namespace runeb
+} // namespace rune
@@ -0,0 +1,166 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "rune/converter.hpp"
+#include "rune/ramp.hpp"
+
+namespace rune {
+
+    // Long-running conversion service on a local Unix socket.
+    //
+    // Each connection carries one job. The client sends a header line and then the
+    // payload that line announces:
+    //
+    //   IMAGE width=80 bytes=N [ramp=dense] [threshold=0.5] [encoding=html]   + N bytes (PNG, JPEG, PPM, ...)
+    //   RAW width=80 size=WxH [...]                                          + W*H*3 bytes of packed RGB24
+    //   VIDEO width=80 fps=10 [keyframes=N] [...] path=/file/on/the/server.mp4
+    //   STATS
+    //
+    // The reply streams each frame as soon as it is converted, as one frames.jsonl
+    // line (or one frames.txt line with encoding=html), followed by a summary line:
+    //
+    //   {"done":{"frames":1,"queue_ms":0.41,"convert_ms":2.13,"total_ms":2.62}}
+    //
+    // A failed job gets a single {"error":"..."} line instead. When every worker is
+    // busy and the queue of waiting connections is full, a new connection is
+    // answered with {"error":"busy"} at once instead of waiting.
+    namespace server {
+
+        using Clock = std::chrono::steady_clock;
+
+        enum class JobKind {
+            Image,  // Encoded image in the payload
+            Raw,    // Packed RGB24 frame in the payload
+            Video,  // Video file the server decodes with ffmpeg
+            Stats   // Server counters and latency percentiles
+        };
+
+        struct Request {
+            JobKind kind = JobKind::Image;
+            int width = 80;                     // Columns of the cell grid
+            std::string ramp = "simple";        // Built-in ramp name
+            float threshold = 1.0f;             // Luminance above which the brightest glyph is used (1 = off, as in rune_cli)
+            bool html = false;                  // encoding=html: frames.txt lines instead of JSON lines
+            size_t bytes = 0;                   // IMAGE payload size
+            int raw_width = 0;                  // RAW frame size
+            int raw_height = 0;
+            int fps = 10;                       // VIDEO sampling rate
+            int keyframe_interval = 0;          // VIDEO: > 1 sends delta frames between keyframes
+            std::string path;                   // VIDEO file; always the last field, so it may hold spaces
+        };
+
+        // Parses a header line (without its newline); throws std::runtime_error on bad input
+        Request parse_request(std::string_view line);
+
+        // Header line for `request`, newline included
+        std::string format_request(const Request& request);
+
+        // Built-in ramp by name ("simple", "dense", "blocks", "dot", "line"), or null
+        const rune::Ramp* find_ramp(std::string_view name);
+
+        // Buffered reads and complete writes on a connected socket, which it owns
+        class Connection {
+        public:
+            explicit Connection(int fd) : fd_(fd) {}
+            Connection(Connection&& other) noexcept;
+            ~Connection();
+
+            Connection(const Connection&) = delete;
+            Connection& operator=(const Connection&) = delete;
+
+            // Next line without its newline; false at end of stream or after max_size bytes
+            bool read_line(std::string& line, size_t max_size = 4096);
+
+            // Exactly `size` bytes; false if the stream ends first
+            bool read_exact(void* data, size_t size);
+
+            // The whole buffer; false once the peer has gone away
+            bool write_all(std::string_view data);
+
+        private:
+            int fd_;
+            std::string pending_;  // Bytes received past the last line read
+        };
+
+        // Connects to a server socket; throws std::runtime_error on failure
+        Connection connect(const std::string& socket_path);
+
+        // Latencies of the most recent `window` requests, for percentiles
+        class LatencyStats {
+        public:
+            explicit LatencyStats(size_t window = 4096);
+
+            void record(double ms);
+
+            // {"count":N,"p50":..,"p90":..,"p99":..,"max":..}, in milliseconds
+            std::string json() const;
+
+        private:
+            mutable std::mutex mutex_;
+            size_t window_;
+            std::vector<double> samples_;
+            size_t next_ = 0;
+            uint64_t count_ = 0;
+        };
+
+        struct ServerOptions {
+            std::string socket_path;
+            int threads = 1;                        // Jobs converted at once
+            int queue_limit = 64;                   // Connections waiting for a worker before new ones are refused
+            converter::ConvertOptions convert;      // Shared by every job (lookup table, frame cache)
+            bool log = false;                       // One JSON line per finished job on stderr
+        };
+
+        // Accepts jobs on the socket and runs them on a fixed pool of workers. Each
+        // worker keeps its own payload buffer and each job its own conversion session,
+        // so concurrent jobs share nothing but the read-only ramps, lookup tables and
+        // the optional frame cache.
+        class Server {
+        public:
+            // Binds and listens, replacing a stale socket file; throws std::runtime_error
+            explicit Server(const ServerOptions& options);
+            ~Server();
+
+            Server(const Server&) = delete;
+            Server& operator=(const Server&) = delete;
+
+            // Serves until `stop` becomes true, then finishes the queued jobs
+            void run(const std::atomic<bool>& stop);
+
+            // {"requests":..,"failed":..,"rejected":..,"active":..,"queued":..,"latency_ms":{..}}
+            std::string stats_json() const;
+
+        private:
+            struct Job {
+                int fd;
+                Clock::time_point accepted;
+            };
+
+            void work();
+            void serve(Connection& connection, Clock::time_point accepted, std::vector<uint8_t>& payload);
+
+            ServerOptions options_;
+            int listen_fd_ = -1;
+
+            mutable std::mutex mutex_;
+            std::condition_variable queue_cv_;
+            std::deque<Job> queue_;
+            bool stopping_ = false;
+
+            std::atomic<uint64_t> requests_ { 0 };
+            std::atomic<uint64_t> failed_ { 0 };
+            std::atomic<uint64_t> rejected_ { 0 };
+            std::atomic<int> active_ { 0 };
+            LatencyStats latency_;
+        };
+
+    } // namespace server
+} // namespace rune
@@ -0,0 +1,97 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "rune/cell.hpp"
+#include "rune/converter.hpp"
+#include "rune/ramp.hpp"
+#include "rune/terminal.hpp"
+#include "rune/writer.hpp"
+
+namespace rune {
+
+    namespace session {
+
+        // What Session::encode produces for the current frame
+        enum class Encoding {
+            Json,  // One line of frames.jsonl (a delta line between keyframes when options.keyframe_interval > 1)
+            Html,  // One line of frames.txt
+            Ansi   // Terminal escape sequence; after the first frame only changed cells are redrawn
+        };
+
+        // Receives encoded bytes; the view is only valid during the call
+        using Sink = std::function<void(std::string_view bytes)>;
+
+        // In-memory conversion for programs that already hold decoded frames.
+        //
+        // feed() converts a caller-owned buffer through a non-owning view, read_cells()
+        // hands out the resulting cells and encode() passes the encoded frame to a
+        // caller-supplied sink. Input pixels are never copied and nothing touches the
+        // filesystem (unless options.cache_dir names a disk cache). Every buffer is
+        // reused from frame to frame, as in the video loop.
+        //
+        // A session converts one stream of frames at a time; use one per thread.
+        // The ramp must outlive the session.
+        class Session {
+        public:
+            Session(int target_width, const rune::Ramp& ramp, float threshold = 0.0f, const converter::ConvertOptions& options = {});
+            ~Session();
+
+            Session(const Session&) = delete;
+            Session& operator=(const Session&) = delete;
+
+            // Converts one frame. The pixels are read in place and not kept, so the
+            // caller may reuse its buffer as soon as feed returns.
+            void feed(converter::ImageView frame);
+
+            // Passes the cells of the last frame to `callback` without copying them
+            void read_cells(const std::function<void(const rune::CellBuffer&)>& callback) const;
+
+            // Copies the cells of the last frame into `cells`, reusing its capacity
+            void read_cells(rune::CellBuffer& cells) const;
+
+            // Encodes the last frame into `sink` and returns the bytes written. Each encoding
+            // is produced once per frame; encoding it again repeats the same bytes.
+            size_t encode(Encoding encoding, const Sink& sink);
+
+            // Palette of the HTML encoding when options.palette_size > 0, else null;
+            // its write_stylesheet gives the CSS the frames refer to
+            const palette::Palette* palette() const { return palette_.get(); }
+
+            // Frames fed so far
+            uint64_t frames() const { return frames_; }
+
+        private:
+            const converter::AsciiFrame& current() const;
+
+            int target_width_;
+            const rune::Ramp& ramp_;
+            float threshold_;
+            converter::ConvertOptions options_;
+
+            std::shared_ptr<const lut::ColorLut> lut_;
+            std::shared_ptr<cache::FrameCache> cache_;
+            std::unique_ptr<palette::Palette> palette_;
+
+            converter::FrameContext context_;
+            converter::AsciiFrame frame_;
+            uint64_t frames_ = 0;
+
+            writer::JsonSerializer serializer_;
+            std::unique_ptr<writer::DeltaEncoder> delta_;
+            std::vector<writer::CellSpan> spans_;
+            terminal::Renderer renderer_;
+
+            // Encodings of the current frame, produced on first request
+            std::string_view json_;
+            bool json_ready_ = false;
+            bool html_ready_ = false;
+            const std::string* ansi_ = nullptr;
+        };
+
+    } // namespace session
+} // namespace rune
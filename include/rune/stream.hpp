@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include "rune/converter.hpp"
+#include "rune/ramp.hpp"
+
+namespace rune {
+
+    namespace stream {
+
+        // Totals for one streaming session
+        struct StreamStats {
+            uint64_t frames_in = 0;    // Complete frames read from the input
+            uint64_t frames_out = 0;   // Frames converted and written
+            uint64_t skipped = 0;      // Arrived ahead of the --target-fps schedule
+            uint64_t dropped = 0;      // Superseded by a newer frame while conversion was busy
+        };
+
+        // Converts a live raw RGB24 feed (stdin or a FIFO) frame by frame.
+        //
+        // A reader thread pulls frames off `in` as they arrive and a converter thread
+        // writes each one to `out` as a JSON line, flushed immediately. Frames that
+        // arrive faster than `target_fps` are skipped (0 disables the limit), and when
+        // conversion falls behind only the newest waiting frame is kept, so latency
+        // stays bounded instead of growing with a backlog. For every written frame
+        // one line {"frame":N,"latency_ms":X,"skipped":S,"dropped":D} goes to `report`,
+        // where latency runs from the frame's last input byte to its output flush.
+        StreamStats stream_raw_to_ascii(
+            std::FILE* in,
+            int frame_width,
+            int frame_height,
+            int target_width,
+            int target_fps,
+            std::FILE* out,
+            std::FILE* report,
+            const rune::Ramp& ramp,
+            float threshold = 0.0f,
+            const rune::converter::ConvertOptions& options = {}
+        );
+
+    } // namespace stream
+} // namespace rune
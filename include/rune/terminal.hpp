@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "cell.hpp"
+#include "ramp.hpp"
+
+namespace rune {
+
+    namespace terminal {
+
+        // 8-bit RGB colour
+        struct Rgb {
+            uint8_t r, g, b;
+        };
+
+        // Converts the quantized cell colour (degrees, %, %) to RGB, as CSS hsl() does
+        Rgb hsl_to_rgb(int h, int s, int l);
+
+        // Renders frames as 24-bit ANSI escape sequences.
+        //
+        // The first frame (and any frame after a size change, or a glyph table that
+        // remaps glyphs rather than only appending new ones) is drawn in full; after
+        // that only cells whose glyph or colour changed are emitted, reached with
+        // cursor moves, and the colour escape is skipped while it stays the same.
+        // Each frame is wrapped in synchronized-update markers so terminals
+        // that support them swap it in at once. The returned string is meant to be
+        // written with a single write() call.
+        class Renderer {
+        public:
+            // Hides the cursor and clears the screen
+            static const char* begin_sequence();
+
+            // Resets colours and shows the cursor again
+            static const char* end_sequence();
+
+            // Escape sequence for this frame; valid until the next call
+            const std::string& render(const CellBuffer& cells);
+
+            // Forces the next frame to be drawn in full
+            void invalidate() { valid_ = false; }
+
+            // Cells emitted by the last render()
+            size_t changed_cells() const { return changed_; }
+
+        private:
+            void move_to(int row, int col);
+            void set_colour(uint16_t h, uint8_t s, uint8_t l);
+            void emit_cell(const CellBuffer& cells, size_t i);
+
+            std::string out_;
+            CellBuffer previous_;
+            std::vector<EncodedGlyph> ansi_;  // previous_.glyph_table, as CompiledRamp::ansi encodes it
+            bool valid_ = false;
+            size_t changed_ = 0;
+
+            // Where the terminal cursor and colour are after the bytes emitted so far
+            int cursor_row_ = -1;
+            int cursor_col_ = -1;
+            int colour_ = -1;
+        };
+
+    } // namespace terminal
+} // namespace rune
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rune {
+
+    namespace pipeline {
+
+        // Runs fn(index, worker) for every index in [0, count) on `threads` workers.
+        //
+        // Indices are dealt round-robin into one deque per worker. A worker takes
+        // from the back of its own deque and, once that is empty, steals from the
+        // front of the others, so a few slow items (large images) do not leave the
+        // remaining workers idle. Returns once every item has run; the first
+        // exception thrown by fn is rethrown after all workers stop.
+        template <typename Fn>
+        void run_work_stealing(int threads, std::size_t count, Fn&& fn) {
+            if (threads < 1) threads = 1;
+            if (static_cast<std::size_t>(threads) > count) threads = static_cast<int>(count == 0 ? 1 : count);
+
+            struct Queue {
+                std::mutex mutex;
+                std::deque<std::size_t> items;
+            };
+
+            std::vector<std::unique_ptr<Queue>> queues;
+            for (int w = 0; w < threads; ++w) queues.push_back(std::make_unique<Queue>());
+            for (std::size_t i = 0; i < count; ++i) queues[i % threads]->items.push_back(i);
+
+            std::mutex error_mutex;
+            std::exception_ptr error;
+
+            auto take = [&](int worker, std::size_t& index) {
+                {
+                    Queue& own = *queues[worker];
+                    std::lock_guard<std::mutex> lock(own.mutex);
+                    if (!own.items.empty()) {
+                        index = own.items.back();
+                        own.items.pop_back();
+                        return true;
+                    }
+                }
+                for (int k = 1; k < threads; ++k) {
+                    Queue& victim = *queues[(worker + k) % threads];
+                    std::lock_guard<std::mutex> lock(victim.mutex);
+                    if (!victim.items.empty()) {
+                        index = victim.items.front();
+                        victim.items.pop_front();
+                        return true;
+                    }
+                }
+                // Nothing is ever added back, so empty everywhere means done
+                return false;
+            };
+
+            auto work = [&](int worker) {
+                std::size_t index;
+                while (take(worker, index)) {
+                    {
+                        std::lock_guard<std::mutex> lock(error_mutex);
+                        if (error) return;
+                    }
+                    try {
+                        fn(index, worker);
+                    } catch (...) {
+                        std::lock_guard<std::mutex> lock(error_mutex);
+                        if (!error) error = std::current_exception();
+                        return;
+                    }
+                }
+            };
+
+            std::vector<std::thread> workers;
+            for (int w = 1; w < threads; ++w) workers.emplace_back(work, w);
+            work(0);
+            for (auto& worker : workers) worker.join();
+
+            if (error) std::rethrow_exception(error);
+        }
+
+    } // namespace pipeline
+} // namespace rune
@@ -2,15 +2,54 @@
 #include <ostream>
 #include "rune/converter.hpp"
 #include "rune/cell.hpp"
+#include "rune/runeb.hpp"
+#include "rune/gzip.hpp"
+#include "rune/io.hpp"
+#include <fstream>
+#include <memory>
+#include <string_view>
+#include <vector>
 #include <zlib.h>
 
 namespace rune {
 
     namespace writer {
+        // A run of changed cells [begin, end) in a delta frame
+        struct CellSpan {
+            uint32_t begin;
+            uint32_t end;
+        };
+
+        // Single-pass JSON frame serializer shared by every JSON sink.
+        //
+        // Glyphs are escaped once per ramp, numbers go through std::to_chars, and the
+        // frame is written into a buffer that keeps its capacity, so after the first
+        // frame serialization allocates nothing. The returned view is valid until the
+        // next call.
+        class JsonSerializer {
+        public:
+            JsonSerializer();
+
+            // {"cells":[{"g":..,"h":..,"s":..,"l":..},...]}\n
+            std::string_view serialize_cells(const rune::CellBuffer& cells);
+
+            // {"d":[{"i":<first cell>,"cells":[...]},...]}\n
+            std::string_view serialize_delta(const rune::CellBuffer& cells, const std::vector<CellSpan>& spans);
+
+        private:
+            void prepare_glyphs(const std::vector<std::string>& glyph_table);
+            char* begin(size_t cells, size_t spans);
+            char* put_cell(char* p, const rune::CellBuffer& cells, size_t i) const;
+
+            std::vector<std::string> glyph_table_;
+            std::vector<std::string> escaped_;
+            size_t max_escaped_ = 0;
+            std::string buffer_;
+        };
+
         void write_cells(
             std::ostream& out,
-            rune::converter::ImageBuffer& image_buffer,
-            const std::vector<rune::Cell>& cells
+            const rune::CellBuffer& cells
         );
 
         void write_html(
@@ -19,18 +58,200 @@ namespace rune {
         );
 
         void write_cells_gzip(
-            gzFile gz,
-            rune::converter::ImageBuffer& image_buffer,
-            const std::vector<rune::Cell>& cells
+            GzipWriter& gz,
+            const rune::CellBuffer& cells
         );
 
+        // image_buffer is the cell grid (AsciiFrame::image_buffer), so its size is the frame's cols x rows.
+        // keyframe_interval > 0 records that frames.jsonl holds delta frames (see DeltaEncoder);
+        // a non-empty stylesheet names the palette CSS file the HTML spans refer to,
+        // and a non-empty playlist the segment playlist that replaces the single frame files
         void write_manifest(
             std::ostream& out, 
             const rune::converter::ImageBuffer& image_buffer,
             const std::string& type,
             int fps,
-            int frame_count
+            int frame_count,
+            int keyframe_interval = 0,
+            const std::string& stylesheet = "",
+            const std::string& playlist = ""
+        );
+
+        // One entry of a multi-width ladder manifest
+        struct Rendition {
+            int cols;
+            int rows;
+            std::string path;  // Subfolder holding the rendition's manifest and frame files
+            uint64_t bytes;    // Size of its main frame file (frames.jsonl.gz or frames.runeb)
+        };
+
+        // Writes the top-level manifest of a multi-width job, smallest rendition first:
+        // {"type":..,"fps":..,"frame_count":..,"renditions":[{"cols":80,"rows":22,"path":"w80","bytes":..},...]}
+        // A player picks the widest rendition that fits, then loads <path>/manifest.json
+        void write_ladder_manifest(
+            std::ostream& out,
+            const std::string& type,
+            int fps,
+            int frame_count,
+            std::vector<Rendition> renditions
+        );
+
+        // Splits a video into keyframes and delta frames.
+        //
+        // Every keyframe_interval-th frame is a keyframe written in full. In between,
+        // only cells whose glyph changed or whose colour moved by more than `tolerance`
+        // (degrees for hue, percentage points for s/l) are kept, as runs of indices.
+        // Cells are compared with what the decoder currently shows, not with the
+        // previous source frame, so small changes cannot accumulate into drift.
+        class DeltaEncoder {
+        public:
+            DeltaEncoder(int keyframe_interval, int tolerance);
+
+            // Returns true if `cells` is a keyframe; otherwise fills `spans` with the changed runs
+            bool encode(const rune::CellBuffer& cells, std::vector<CellSpan>& spans);
+
+            // Makes the next frame a keyframe (used at gzip seek points)
+            void force_keyframe() { force_keyframe_ = true; }
+
+        private:
+            bool changed(const rune::CellBuffer& cells, size_t i) const;
+
+            int keyframe_interval_;
+            int tolerance_;
+            int frame_ = 0;
+            bool force_keyframe_ = false;
+            rune::CellBuffer reference_;
+        };
+
+        // Writes a delta frame as {"d":[{"i":<first cell>,"cells":[...]},...]}
+        void write_delta(
+            std::ostream& out,
+            const rune::CellBuffer& cells,
+            const std::vector<CellSpan>& spans
+        );
+
+        void write_delta_gzip(
+            GzipWriter& gz,
+            const rune::CellBuffer& cells,
+            const std::vector<CellSpan>& spans
         );
+
+        // One random-access point in frames.jsonl.gz
+        struct SeekPoint {
+            int frame;                // First frame in this gzip member
+            uint64_t offset;          // Byte offset of the member in the .gz file
+            uint64_t raw_offset;      // Byte offset of the frame in the uncompressed JSONL
+        };
+
+        // Writes the sidecar index for a seekable .jsonl.gz:
+        // {"interval":K,"size":..,"raw_size":..,"points":[{"frame":0,"offset":0,"raw_offset":0},...]}
+        void write_seek_index(
+            std::ostream& out,
+            int interval,
+            const std::vector<SeekPoint>& points,
+            uint64_t size,
+            uint64_t raw_size
+        );
+
+        // One finished chunk of a segmented job
+        struct Segment {
+            std::string name;   // File base of the chunk ("frames_00003"); extensions as for FrameOutputs
+            int first_frame;
+            int frame_count;
+            uint64_t bytes;     // Size of its main frame file (.jsonl.gz or .runeb)
+        };
+
+        // Writes the playlist of a segmented job. Segments start on a keyframe and decode
+        // on their own; "complete" stays false while the job is still adding segments:
+        // {"cols":..,"rows":..,"fps":..,"segment_frames":..,"frame_count":..,"complete":false,
+        //  "segments":[{"name":"frames_00000","first_frame":0,"frame_count":88,"duration":8,"bytes":..},...]}
+        void write_playlist(
+            std::ostream& out,
+            int cols,
+            int rows,
+            int fps,
+            int segment_frames,
+            const std::vector<Segment>& segments,
+            bool complete,
+            const std::string& stylesheet = ""
+        );
+
+        // Background writer for the frame files of one job, configured by options.io_queue_mb,
+        // io_uring and fsync; null when io_queue_mb is 0 (inline writes)
+        std::unique_ptr<rune::io::WriteQueue> make_write_queue(const rune::converter::ConvertOptions& options);
+
+        // The frame files one conversion job writes, selected by options.format:
+        //   Jsonl -> <base>.jsonl, <base>.jsonl.gz and <base>.txt (HTML spans),
+        //            plus <base>.jsonl.gz.index.json when options.seek_interval > 0
+        //   Runeb -> <base>.runeb
+        //
+        // With options.segment_seconds > 0 (and fps > 0) the same files are cut into chunks
+        // named <base>_00000, <base>_00001, ... of that many seconds each, and
+        // playlist.json next to them is rewritten (atomically) as each chunk is finished.
+        class FrameOutputs {
+        public:
+            FrameOutputs() = default;
+            ~FrameOutputs();
+
+            FrameOutputs(const FrameOutputs&) = delete;
+            FrameOutputs& operator=(const FrameOutputs&) = delete;
+
+            // Opens every enabled output; reports the failing file and returns false on error.
+            // With a queue (see make_write_queue) the frame files are written by its I/O
+            // thread; it must outlive this object. Without one they are written inline.
+            bool open(const std::string& filename_base, int fps, const rune::converter::ConvertOptions& options, rune::io::WriteQueue* queue = nullptr);
+
+            // Whether any output consumes AsciiFrame::html (add_html can be skipped otherwise)
+            bool wants_html() const { return format_ == rune::converter::OutputFormat::Jsonl; }
+
+            // Palette for add_html when options.palette_size > 0, else null
+            const rune::palette::Palette* palette() const { return palette_.get(); }
+
+            // Appends one frame to every enabled output
+            void write_frame(const rune::converter::AsciiFrame& ascii_frame);
+
+            // Flushes and closes all outputs
+            void close();
+
+            // Total size of the main frame files (.jsonl.gz or .runeb, across all segments); final after close()
+            uint64_t main_bytes() const { return main_bytes_; }
+
+            // File name of the playlist when the job is segmented, else empty
+            std::string playlist_name() const { return segment_frames_ > 0 ? "playlist.json" : ""; }
+
+        private:
+            bool open_files(const std::string& base);
+            uint64_t close_files();  // Returns the size of the main frame file just closed
+            void finish_segment(bool complete);
+            rune::converter::OutputFormat format_ = rune::converter::OutputFormat::Jsonl;
+            JsonSerializer serializer_;
+            std::unique_ptr<DeltaEncoder> delta_;
+            std::vector<CellSpan> spans_;
+            std::ofstream j_data_out_;
+            std::ofstream h_data_out_;
+            rune::io::WriteQueue* io_ = nullptr;  // Writes every frame file when set
+            int j_file_ = -1;
+            int h_file_ = -1;
+            GzipWriter gz_;
+            std::string filename_base_;
+            std::string files_base_;           // Base of the files currently open (a segment's when segmented)
+            rune::converter::ConvertOptions options_;
+            int fps_ = 0;
+            int seek_interval_ = 0;
+            int frames_written_ = 0;
+            int frames_in_files_ = 0;
+            std::vector<SeekPoint> seek_points_;
+            rune::runeb::Writer runeb_;
+            std::unique_ptr<rune::palette::Palette> palette_;
+            bool open_ = false;
+            uint64_t main_bytes_ = 0;
+
+            // Segmented mode
+            int segment_frames_ = 0;
+            int cols_ = 0;
+            int rows_ = 0;
+            std::vector<Segment> segments_;
+        };
     }
 
 }
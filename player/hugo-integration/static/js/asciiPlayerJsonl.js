@@ -140,6 +140,28 @@ export function createAsciiPlayerJsonl({
 
     lines.forEach((line, frameIdx) => {
       const frame = JSON.parse(line);
+
+      // Delta frame (manifest.keyframe_interval > 1): copy the previous frame, then patch changed spans
+      if (frame.d) {
+        const offset = frameIdx * cellCount;
+        const prevOffset = offset - cellCount;
+        glyphs.copyWithin(offset, prevOffset, offset);
+        hues.copyWithin(offset, prevOffset, offset);
+        saturations.copyWithin(offset, prevOffset, offset);
+        lightness.copyWithin(offset, prevOffset, offset);
+
+        frame.d.forEach((span) => {
+          span.cells.forEach((cell, k) => {
+            const idx = offset + span.i + k;
+            glyphs[idx] = cell.g.codePointAt(0) || 0;
+            hues[idx] = cell.h || 0;
+            saturations[idx] = cell.s || 0;
+            lightness[idx] = cell.l || 0;
+          });
+        });
+        return;
+      }
+
       frame.cells.forEach((cell, cellIdx) => {
         const idx = frameIdx * cellCount + cellIdx;
         const glyphCode = cell.g.codePointAt(0) || 0;
@@ -2,6 +2,7 @@
 export function createAsciiPlayer({
     container,
     framesPath,
+    maxCols = null,
   }) {
     let frames = [];
     let frameIndex = 0;
@@ -15,27 +16,106 @@ export function createAsciiPlayer({
     let lastTime = 0;
     let accumulator = 0;
   
+    // Widest rendition of a ladder that fits maxCols (or the container), else the narrowest.
+    // Renditions are listed narrowest first.
+    function pickRendition(renditions) {
+      let limit = maxCols;
+      if (!limit) {
+        const probe = document.createElement("span");
+        probe.textContent = "MMMMMMMMMM";
+        container.appendChild(probe);
+        const charWidth = probe.getBoundingClientRect().width / 10 || 8;
+        container.removeChild(probe);
+        limit = Math.floor(container.clientWidth / charWidth);
+      }
+
+      let pick = renditions[0];
+      for (const rendition of renditions) {
+        if (rendition.cols <= limit) pick = rendition;
+      }
+      return pick;
+    }
+
     async function loadManifest() {
       const res = await fetch(`${framesPath}/manifest.json`);
-      return res.json();
+
+      // A segmented conversion still in progress has only published its playlist so far
+      if (!res.ok) {
+        const live = await fetch(`${framesPath}/playlist.json`, { cache: "no-store" });
+        return { ...(await live.json()), playlist: "playlist.json" };
+      }
+
+      const manifest = await res.json();
+
+      // Multi-width output (--width 80,120,200): continue with the rendition that fits
+      if (manifest.renditions) {
+        framesPath = `${framesPath}/${pickRendition(manifest.renditions).path}`;
+        return (await fetch(`${framesPath}/manifest.json`)).json();
+      }
+      return manifest;
     }
   
-    async function loadFrames() {
-      const res = await fetch(`${framesPath}/frames.txt`);
-      const text = await res.text();
-  
+    function parseFrames(text) {
       // Each line = one frame (HTML string)
-      frames = text
+      return text
         .split("\n")
         .filter(Boolean)
         .map(line => line.replace(/\\n/g, "\n"));
     }
-  
+
+    async function loadFrames() {
+      const res = await fetch(`${framesPath}/frames.txt`);
+      frames = parseFrames(await res.text());
+    }
+
+    // Segmented output (--segment-seconds): manifest.playlist lists chunks of frames.
+    // Only the chunk on screen and the next one are held, and a playlist that is not
+    // yet complete (a conversion still running) is polled for new chunks.
+    let playlist = null;
+    let playlistName = null;
+    let segmentIndex = 0;
+    let next = null;  // { index, frames } once the following chunk has loaded
+
+    async function loadPlaylist() {
+      const res = await fetch(`${framesPath}/${playlistName}`, { cache: "no-store" });
+      playlist = await res.json();
+    }
+
+    async function fetchSegment(index) {
+      while (index >= playlist.segments.length) {
+        if (playlist.complete) {
+          index = 0;  // Loop back to the start
+          break;
+        }
+        const segmentMs = 1000 * playlist.segment_frames / (playlist.fps || 12);
+        await new Promise(resolve => setTimeout(resolve, segmentMs));
+        await loadPlaylist();
+      }
+      const res = await fetch(`${framesPath}/${playlist.segments[index].name}.txt`);
+      return { index, frames: parseFrames(await res.text()) };
+    }
+
+    function prefetch(index) {
+      next = null;
+      fetchSegment(index).then(segment => { next = segment; });
+    }
+
     function renderFrame() {
+      if (frameIndex >= frames.length) {
+        if (playlist) {
+          // Hold the last frame until the next chunk has arrived
+          if (!next) return;
+          segmentIndex = next.index;
+          frames = next.frames;
+          prefetch(segmentIndex + 1);
+        }
+        frameIndex = 0;
+      }
+
       container.innerHTML = frames[frameIndex];
-      frameIndex = (frameIndex + 1) % frames.length;
+      frameIndex++;
     }
-  
+
     function tick(now) {
       if (!running) return;
   
@@ -58,9 +138,27 @@ export function createAsciiPlayer({
   
       const manifest = await loadManifest();
       fps = manifest.fps || 12;
+
+      // Palette output (--palette N): spans use classes defined in a shared stylesheet
+      if (manifest.stylesheet && !document.querySelector(`link[data-ascii-palette="${framesPath}"]`)) {
+        const link = document.createElement("link");
+        link.rel = "stylesheet";
+        link.href = `${framesPath}/${manifest.stylesheet}`;
+        link.dataset.asciiPalette = framesPath;
+        document.head.appendChild(link);
+      }
       frameTime = 1000 / fps;
   
-      await loadFrames();
+      if (manifest.playlist) {
+        playlistName = manifest.playlist;
+        await loadPlaylist();
+        const first = await fetchSegment(0);
+        segmentIndex = first.index;
+        frames = first.frames;
+        prefetch(segmentIndex + 1);
+      } else {
+        await loadFrames();
+      }
   
       frameIndex = 0;
       accumulator = 0;
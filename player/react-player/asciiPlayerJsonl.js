@@ -6,6 +6,7 @@ export function createAsciiPlayerJsonl({
   framesPath,
   preferGzip = true,
   onReady = null,
+  maxCols = null,
 }) {
   let cellSpans = [];
 
@@ -48,9 +49,35 @@ export function createAsciiPlayerJsonl({
     return `hsl(${h}, ${s}%, ${l}%)`;
   }
 
+  // Widest rendition of a ladder that fits maxCols (or the container), else the narrowest.
+  // Renditions are listed narrowest first.
+  function pickRendition(renditions) {
+    let limit = maxCols;
+    if (!limit) {
+      const probe = document.createElement("span");
+      probe.textContent = "MMMMMMMMMM";
+      container.appendChild(probe);
+      const charWidth = probe.getBoundingClientRect().width / 10 || 8;
+      container.removeChild(probe);
+      limit = Math.floor(container.clientWidth / charWidth);
+    }
+
+    let pick = renditions[0];
+    for (const rendition of renditions) {
+      if (rendition.cols <= limit) pick = rendition;
+    }
+    return pick;
+  }
+
   async function loadManifest() {
     const res = await fetch(`${framesPath}/manifest.json`);
-    const manifest = await res.json();
+    let manifest = await res.json();
+
+    // Multi-width output (--width 80,120,200): continue with the rendition that fits
+    if (manifest.renditions) {
+      framesPath = `${framesPath}/${pickRendition(manifest.renditions).path}`;
+      manifest = await (await fetch(`${framesPath}/manifest.json`)).json();
+    }
 
 
     cols = manifest.cols;
@@ -124,6 +151,28 @@ export function createAsciiPlayerJsonl({
 
     lines.forEach((line, frameIdx) => {
       const frame = JSON.parse(line);
+
+      // Delta frame (manifest.keyframe_interval > 1): copy the previous frame, then patch changed spans
+      if (frame.d) {
+        const offset = frameIdx * cellCount;
+        const prevOffset = offset - cellCount;
+        glyphs.copyWithin(offset, prevOffset, offset);
+        hues.copyWithin(offset, prevOffset, offset);
+        saturations.copyWithin(offset, prevOffset, offset);
+        lightness.copyWithin(offset, prevOffset, offset);
+
+        frame.d.forEach((span) => {
+          span.cells.forEach((cell, k) => {
+            const idx = offset + span.i + k;
+            glyphs[idx] = cell.g.charCodeAt(0);
+            hues[idx] = cell.h || 0;
+            saturations[idx] = cell.s || 0;
+            lightness[idx] = cell.l || 0;
+          });
+        });
+        return;
+      }
+
       frame.cells.forEach((cell, cellIdx) => {
         const idx = frameIdx * cellCount + cellIdx;
         glyphs[idx] = cell.g.charCodeAt(0);
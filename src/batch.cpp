@@ -0,0 +1,164 @@
+#include "rune/batch.hpp"
+#include "rune/work_stealing.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <glob.h>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <stdexcept>
+
+namespace rune {
+    namespace batch {
+
+        namespace {
+
+            bool is_image(const std::filesystem::path& path) {
+                std::string ext = path.extension().string();
+                std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+
+                // Formats stb_image can decode
+                static const char* extensions[] = { ".png", ".jpg", ".jpeg", ".bmp", ".gif", ".tga", ".psd", ".hdr", ".pic", ".pnm", ".ppm", ".pgm" };
+                return std::any_of(std::begin(extensions), std::end(extensions), [&](const char* e) { return ext == e; });
+            }
+
+            std::string json_escape(const std::string& s) {
+                std::string out;
+                for (char c : s) {
+                    if (c == '"' || c == '\\') out += '\\';
+                    out += c;
+                }
+                return out;
+            }
+
+        } // namespace
+
+        std::vector<std::string> collect_inputs(const std::string& spec) {
+            std::vector<std::string> inputs;
+
+            if (std::filesystem::is_directory(spec)) {
+                for (auto& entry : std::filesystem::directory_iterator(spec)) {
+                    if (entry.is_regular_file() && is_image(entry.path())) {
+                        inputs.push_back(entry.path().string());
+                    }
+                }
+            } else if (spec.find_first_of("*?[") != std::string::npos) {
+                glob_t matches {};
+                int ret = glob(spec.c_str(), 0, nullptr, &matches);
+                if (ret != 0 && ret != GLOB_NOMATCH) {
+                    globfree(&matches);
+                    throw std::runtime_error("failed to expand glob: " + spec);
+                }
+                for (size_t i = 0; i < matches.gl_pathc; ++i) {
+                    inputs.emplace_back(matches.gl_pathv[i]);
+                }
+                globfree(&matches);
+            } else {
+                std::ifstream list(spec);
+                if (!list) {
+                    throw std::runtime_error("failed to open image list: " + spec);
+                }
+                std::string line;
+                while (std::getline(list, line)) {
+                    if (!line.empty() && line.back() == '\r') line.pop_back();
+                    if (line.empty() || line[0] == '#') continue;
+                    inputs.push_back(line);
+                }
+            }
+
+            std::sort(inputs.begin(), inputs.end());
+            return inputs;
+        }
+
+        std::vector<ImageResult> convert_images(const std::vector<std::string>& inputs, int target_width, const std::string& output_folder, const rune::Ramp& ramp, float threshold, const rune::converter::ConvertOptions& options) {
+            std::vector<ImageResult> results(inputs.size());
+
+            // Subfolders are named up front so workers never race on a name. Every name
+            // handed out is remembered, so a suffixed "a_1" cannot collide with an input
+            // whose own stem is "a_1"
+            std::set<std::string> taken;
+            std::map<std::string, int> next_suffix;
+            for (size_t i = 0; i < inputs.size(); ++i) {
+                std::string stem = std::filesystem::path(inputs[i]).stem().string();
+                if (stem.empty()) stem = "image";
+
+                std::string name = stem;
+                int& n = next_suffix[stem];
+                while (!taken.insert(name).second) {
+                    name = stem + "_" + std::to_string(++n);
+                }
+
+                results[i].input = inputs[i];
+                results[i].output_folder = output_folder + "/" + name;
+            }
+
+            std::filesystem::create_directories(output_folder);
+
+            // Parallelism comes from the pool; each image converts and compresses inline
+            rune::converter::ConvertOptions image_options = options;
+            image_options.threads = 1;
+            image_options.gzip_threads = 1;
+
+            pipeline::run_work_stealing(options.threads, inputs.size(), [&](size_t i, int) {
+                ImageResult& result = results[i];
+                auto start = std::chrono::steady_clock::now();
+
+                try {
+                    rune::converter::convert_image_to_ascii(result.input, target_width, result.output_folder, ramp, threshold, image_options);
+                    result.ok = true;
+                } catch (const std::exception& e) {
+                    result.error = e.what();
+                }
+
+                result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            });
+
+            return results;
+        }
+
+        void write_summary(const std::vector<ImageResult>& results, const std::string& output_folder, double total_milliseconds) {
+            double sum = 0.0;
+            size_t failed = 0;
+
+            std::cout << std::fixed << std::setprecision(2);
+            for (const ImageResult& result : results) {
+                std::cout << std::setw(10) << result.milliseconds << " ms  " << result.input;
+                if (!result.ok) std::cout << "  FAILED: " << result.error;
+                std::cout << "\n";
+
+                sum += result.milliseconds;
+                if (!result.ok) ++failed;
+            }
+            std::cout << results.size() << " images (" << failed << " failed) in " << total_milliseconds
+                      << " ms wall, " << sum << " ms of conversion\n";
+
+            std::ofstream out(output_folder + "/batch.json");
+            if (!out) {
+                std::cerr << "failed to open output file\n";
+                return;
+            }
+
+            out << std::fixed << std::setprecision(3);
+            out << "{\n  \"images\": [\n";
+            for (size_t i = 0; i < results.size(); ++i) {
+                const ImageResult& r = results[i];
+                out << "    {\"input\":\"" << json_escape(r.input) << "\",\"output\":\"" << json_escape(r.output_folder)
+                    << "\",\"ms\":" << r.milliseconds << ",\"ok\":" << (r.ok ? "true" : "false");
+                if (!r.ok) out << ",\"error\":\"" << json_escape(r.error) << "\"";
+                out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+            }
+            out << "  ],\n";
+            out << "  \"count\": " << results.size() << ",\n";
+            out << "  \"failed\": " << failed << ",\n";
+            out << "  \"wall_ms\": " << total_milliseconds << ",\n";
+            out << "  \"total_ms\": " << sum << "\n";
+            out << "}\n";
+        }
+
+    } // namespace batch
+} // namespace rune
@@ -0,0 +1,493 @@
+#include "rune/cache.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <tuple>
+#include <unistd.h>
+
+namespace rune {
+    namespace cache {
+
+        namespace {
+
+            constexpr uint64_t P1 = 0x9E3779B185EBCA87ull;
+            constexpr uint64_t P2 = 0xC2B2AE3D27D4EB4Full;
+            constexpr uint64_t P3 = 0x165667B19E3779F9ull;
+            constexpr uint64_t P4 = 0x85EBCA77C2B2AE63ull;
+            constexpr uint64_t P5 = 0x27D4EB2F165667C5ull;
+
+            constexpr uint32_t HEADER_SIZE = 40;
+            const char* const EXTENSION = ".cell";
+
+            uint64_t read64(const uint8_t* p) {
+                uint64_t v;
+                std::memcpy(&v, p, 8);
+                return v;
+            }
+
+            uint32_t read32(const uint8_t* p) {
+                uint32_t v;
+                std::memcpy(&v, p, 4);
+                return v;
+            }
+
+            uint64_t round(uint64_t acc, uint64_t input) {
+                acc += input * P2;
+                acc = std::rotl(acc, 31);
+                return acc * P1;
+            }
+
+            uint64_t merge(uint64_t acc, uint64_t value) {
+                acc ^= round(0, value);
+                return acc * P1 + P4;
+            }
+
+            void put_u16(uint8_t* p, uint16_t v) {
+                p[0] = static_cast<uint8_t>(v);
+                p[1] = static_cast<uint8_t>(v >> 8);
+            }
+
+            void put_u32(uint8_t* p, uint32_t v) {
+                for (int i = 0; i < 4; ++i) p[i] = static_cast<uint8_t>(v >> (8 * i));
+            }
+
+            void put_u64(uint8_t* p, uint64_t v) {
+                for (int i = 0; i < 8; ++i) p[i] = static_cast<uint8_t>(v >> (8 * i));
+            }
+
+            uint16_t get_u16(const uint8_t* p) {
+                return static_cast<uint16_t>(p[0] | (p[1] << 8));
+            }
+
+            uint32_t get_u32(const uint8_t* p) {
+                uint32_t v = 0;
+                for (int i = 0; i < 4; ++i) v |= static_cast<uint32_t>(p[i]) << (8 * i);
+                return v;
+            }
+
+            uint64_t get_u64(const uint8_t* p) {
+                uint64_t v = 0;
+                for (int i = 0; i < 8; ++i) v |= static_cast<uint64_t>(p[i]) << (8 * i);
+                return v;
+            }
+
+            size_t entry_bytes(const converter::ImageBuffer& grid, const rune::CellBuffer& cells) {
+                size_t glyph_bytes = 0;
+                for (const auto& glyph : cells.glyph_table) glyph_bytes += 1 + glyph.size();
+                return HEADER_SIZE + glyph_bytes + grid.pixels.size() + cells.size() * 5;
+            }
+
+            std::vector<uint8_t> encode(const Key& key, const converter::ImageBuffer& grid, const rune::CellBuffer& cells) {
+                std::vector<uint8_t> bytes(entry_bytes(grid, cells));
+                uint8_t* p = bytes.data();
+
+                std::memcpy(p, "RUNC", 4);
+                put_u16(p + 4, VERSION);
+                put_u16(p + 6, 0);
+                put_u64(p + 8, key.pixels);
+                put_u64(p + 16, key.settings);
+                put_u32(p + 24, static_cast<uint32_t>(cells.cols));
+                put_u32(p + 28, static_cast<uint32_t>(cells.rows));
+                put_u32(p + 32, static_cast<uint32_t>(grid.channels));
+                put_u32(p + 36, static_cast<uint32_t>(cells.glyph_table.size()));
+                p += HEADER_SIZE;
+
+                for (const auto& glyph : cells.glyph_table) {
+                    *p++ = static_cast<uint8_t>(glyph.size());
+                    std::memcpy(p, glyph.data(), glyph.size());
+                    p += glyph.size();
+                }
+
+                std::memcpy(p, grid.pixels.data(), grid.pixels.size());
+                p += grid.pixels.size();
+
+                const size_t count = cells.size();
+                for (size_t i = 0; i < count; ++i) {
+                    put_u16(p + i * 2, cells.h[i]);
+                }
+                std::memcpy(p + count * 2, cells.glyphs.data(), count);
+                std::memcpy(p + count * 3, cells.s.data(), count);
+                std::memcpy(p + count * 4, cells.l.data(), count);
+                return bytes;
+            }
+
+            // Fills grid and cells from a cache file; false if it is truncated or for another key
+            bool decode(const std::vector<uint8_t>& bytes, const Key& key, converter::ImageBuffer& grid, rune::CellBuffer& cells) {
+                if (bytes.size() < HEADER_SIZE || std::memcmp(bytes.data(), "RUNC", 4) != 0) return false;
+
+                const uint8_t* p = bytes.data();
+                if (get_u16(p + 4) != VERSION || get_u64(p + 8) != key.pixels || get_u64(p + 16) != key.settings) return false;
+
+                const int cols = static_cast<int>(get_u32(p + 24));
+                const int rows = static_cast<int>(get_u32(p + 28));
+                const int channels = static_cast<int>(get_u32(p + 32));
+                const uint32_t glyph_count = get_u32(p + 36);
+
+                const uint8_t* end = bytes.data() + bytes.size();
+                p += HEADER_SIZE;
+
+                cells.glyph_table.resize(glyph_count);
+                for (uint32_t i = 0; i < glyph_count; ++i) {
+                    if (p >= end || end - p < 1 + *p) return false;
+                    cells.glyph_table[i].assign(reinterpret_cast<const char*>(p + 1), *p);
+                    p += 1 + *p;
+                }
+
+                const size_t count = static_cast<size_t>(cols) * rows;
+                const size_t grid_bytes = count * channels;
+                if (static_cast<size_t>(end - p) != grid_bytes + count * 5) return false;
+
+                grid.width = cols;
+                grid.height = rows;
+                grid.channels = channels;
+                grid.pixels.assign(p, p + grid_bytes);
+                p += grid_bytes;
+
+                cells.resize(cols, rows);
+                for (size_t i = 0; i < count; ++i) {
+                    cells.h[i] = get_u16(p + i * 2);
+                }
+                std::memcpy(cells.glyphs.data(), p + count * 2, count);
+                std::memcpy(cells.s.data(), p + count * 3, count);
+                std::memcpy(cells.l.data(), p + count * 4, count);
+                return true;
+            }
+
+            bool parse_hex(const std::string& text, uint64_t& value) {
+                if (text.size() != 16) return false;
+                value = 0;
+                for (char c : text) {
+                    int digit;
+                    if (c >= '0' && c <= '9') digit = c - '0';
+                    else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+                    else return false;
+                    value = (value << 4) | static_cast<uint64_t>(digit);
+                }
+                return true;
+            }
+
+        } // namespace
+
+        uint64_t hash_bytes(const void* data, size_t size, uint64_t seed) {
+            const uint8_t* p = static_cast<const uint8_t*>(data);
+            const uint8_t* const end = p + size;
+            uint64_t h;
+
+            if (size >= 32) {
+                // Four independent lanes keep the multiplier pipelines full
+                uint64_t v1 = seed + P1 + P2;
+                uint64_t v2 = seed + P2;
+                uint64_t v3 = seed;
+                uint64_t v4 = seed - P1;
+                const uint8_t* const limit = end - 32;
+                do {
+                    v1 = round(v1, read64(p));
+                    v2 = round(v2, read64(p + 8));
+                    v3 = round(v3, read64(p + 16));
+                    v4 = round(v4, read64(p + 24));
+                    p += 32;
+                } while (p <= limit);
+
+                h = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+                h = merge(h, v1);
+                h = merge(h, v2);
+                h = merge(h, v3);
+                h = merge(h, v4);
+            } else {
+                h = seed + P5;
+            }
+
+            h += static_cast<uint64_t>(size);
+
+            for (; p + 8 <= end; p += 8) {
+                h ^= round(0, read64(p));
+                h = std::rotl(h, 27) * P1 + P4;
+            }
+            if (p + 4 <= end) {
+                h ^= static_cast<uint64_t>(read32(p)) * P1;
+                h = std::rotl(h, 23) * P2 + P3;
+                p += 4;
+            }
+            for (; p < end; ++p) {
+                h ^= static_cast<uint64_t>(*p) * P5;
+                h = std::rotl(h, 11) * P1;
+            }
+
+            h ^= h >> 33;
+            h *= P2;
+            h ^= h >> 29;
+            h *= P3;
+            h ^= h >> 32;
+            return h;
+        }
+
+        std::string Key::hex() const {
+            static const char digits[] = "0123456789abcdef";
+            std::string out(32, '0');
+            for (int i = 0; i < 16; ++i) {
+                out[15 - i] = digits[(pixels >> (4 * i)) & 0xF];
+                out[31 - i] = digits[(settings >> (4 * i)) & 0xF];
+            }
+            return out;
+        }
+
+        Key make_key(converter::ImageView image, int target_width, const rune::Ramp& ramp, float threshold, int lut_bits) {
+            // Everything that changes the cells besides the pixels themselves
+            const uint32_t settings[] = {
+                VERSION,
+                static_cast<uint32_t>(image.width),
+                static_cast<uint32_t>(image.height),
+                static_cast<uint32_t>(image.channels),
+                static_cast<uint32_t>(target_width),
+                std::bit_cast<uint32_t>(threshold),
+                static_cast<uint32_t>(lut_bits),
+            };
+
+            Key key;
+            const size_t packed_row = static_cast<size_t>(image.width) * image.channels;
+            if (image.row_bytes() == packed_row) {
+                key.pixels = hash_bytes(image.pixels, packed_row * image.height);
+            } else {
+                // Padded rows are hashed one after another, skipping the padding
+                for (int y = 0; y < image.height; ++y) {
+                    key.pixels = hash_bytes(image.row(y), packed_row, key.pixels);
+                }
+            }
+            key.settings = hash_bytes(ramp.chars.data(), ramp.chars.size(), hash_bytes(settings, sizeof(settings)));
+            return key;
+        }
+
+        FrameCache::FrameCache(size_t memory_bytes, const std::string& folder, uint64_t disk_bytes)
+            : memory_limit_(memory_bytes), folder_(folder), disk_limit_(disk_bytes) {
+            if (!folder_.empty()) {
+                std::filesystem::create_directories(folder_);
+                load_disk_index();
+                for (const auto& path : trim_disk()) {
+                    std::error_code ec;
+                    std::filesystem::remove(path, ec);
+                }
+            }
+        }
+
+        std::string FrameCache::path_for(const Key& key) const {
+            return folder_ + "/" + key.hex() + EXTENSION;
+        }
+
+        void FrameCache::load_disk_index() {
+            struct Found {
+                std::filesystem::file_time_type time;
+                DiskEntry entry;
+            };
+            std::vector<Found> found;
+
+            for (const auto& file : std::filesystem::directory_iterator(folder_)) {
+                const std::filesystem::path& path = file.path();
+                const std::string stem = path.stem().string();
+
+                Key key;
+                if (path.extension() != EXTENSION || stem.size() != 32
+                    || !parse_hex(stem.substr(0, 16), key.pixels) || !parse_hex(stem.substr(16), key.settings)) {
+                    continue;
+                }
+
+                std::error_code ec;
+                const uint64_t bytes = file.file_size(ec);
+                const auto time = file.last_write_time(ec);
+                if (ec) continue;
+
+                found.push_back(Found { time, DiskEntry { key, bytes } });
+            }
+
+            // Oldest first, so pushing to the front leaves the newest entry at the head
+            std::sort(found.begin(), found.end(), [](const Found& a, const Found& b) { return a.time < b.time; });
+            for (const Found& f : found) {
+                disk_.push_front(f.entry);
+                disk_index_[f.entry.key] = disk_.begin();
+                disk_bytes_ += f.entry.bytes;
+            }
+        }
+
+        std::vector<std::string> FrameCache::trim_disk() {
+            std::vector<std::string> evicted;
+            while (disk_bytes_ > disk_limit_ && !disk_.empty()) {
+                const DiskEntry& last = disk_.back();
+                evicted.push_back(path_for(last.key));
+                disk_bytes_ -= last.bytes;
+                disk_index_.erase(last.key);
+                disk_.pop_back();
+                stats_.evictions++;
+            }
+            return evicted;
+        }
+
+        bool FrameCache::lookup(const Key& key, converter::ImageBuffer& grid, rune::CellBuffer& cells) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+
+                auto it = memory_index_.find(key);
+                if (it != memory_index_.end()) {
+                    memory_.splice(memory_.begin(), memory_, it->second);
+                    const Entry& entry = *it->second;
+                    grid.width = entry.grid.width;
+                    grid.height = entry.grid.height;
+                    grid.channels = entry.grid.channels;
+                    grid.pixels = entry.grid.pixels;
+                    cells = entry.cells;
+                    stats_.memory_hits++;
+                    return true;
+                }
+
+                if (disk_index_.find(key) == disk_index_.end()) {
+                    stats_.misses++;
+                    return false;
+                }
+            }
+
+            // The file is read without holding the lock; it may have been evicted meanwhile
+            const std::string path = path_for(key);
+            std::vector<uint8_t> bytes;
+            {
+                std::ifstream in(path, std::ios::binary | std::ios::ate);
+                if (in) {
+                    bytes.resize(static_cast<size_t>(in.tellg()));
+                    in.seekg(0);
+                    in.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+                    if (!in) bytes.clear();
+                }
+            }
+
+            const bool ok = decode(bytes, key, grid, cells);
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = disk_index_.find(key);
+            if (!ok) {
+                // Unreadable or foreign file: forget it so the next insert rewrites it
+                if (it != disk_index_.end()) {
+                    disk_bytes_ -= it->second->bytes;
+                    disk_.erase(it->second);
+                    disk_index_.erase(it);
+                }
+                stats_.misses++;
+                return false;
+            }
+
+            if (it != disk_index_.end()) {
+                disk_.splice(disk_.begin(), disk_, it->second);
+            }
+            std::error_code ec;
+            std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+
+            stats_.disk_hits++;
+            insert_memory(key, grid, cells);
+            return true;
+        }
+
+        void FrameCache::insert(const Key& key, const converter::ImageBuffer& grid, const rune::CellBuffer& cells) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                insert_memory(key, grid, cells);
+                if (folder_.empty() || disk_index_.count(key)) {
+                    return;
+                }
+            }
+
+            // Written under a unique temporary name and renamed into place, so readers
+            // (including other processes sharing the folder) never see a partial file
+            static std::atomic<uint64_t> sequence { 0 };
+            const std::vector<uint8_t> bytes = encode(key, grid, cells);
+            const std::string path = path_for(key);
+            const std::string temp = path + ".tmp" + std::to_string(::getpid()) + "_" + std::to_string(sequence++);
+            {
+                std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+                if (!out) {
+                    return;
+                }
+                out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+                if (!out) {
+                    out.close();
+                    std::error_code ec;
+                    std::filesystem::remove(temp, ec);
+                    return;
+                }
+            }
+            std::error_code ec;
+            std::filesystem::rename(temp, path, ec);
+            if (ec) {
+                std::filesystem::remove(temp, ec);
+                return;
+            }
+
+            std::vector<std::string> evicted;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (disk_index_.count(key)) {
+                    return;
+                }
+                disk_.push_front(DiskEntry { key, bytes.size() });
+                disk_index_[key] = disk_.begin();
+                disk_bytes_ += bytes.size();
+                evicted = trim_disk();
+            }
+            for (const auto& file : evicted) {
+                std::filesystem::remove(file, ec);
+            }
+        }
+
+        void FrameCache::insert_memory(const Key& key, const converter::ImageBuffer& grid, const rune::CellBuffer& cells) {
+            const size_t bytes = entry_bytes(grid, cells);
+            if (bytes > memory_limit_) {
+                return;
+            }
+
+            auto it = memory_index_.find(key);
+            if (it != memory_index_.end()) {
+                memory_.splice(memory_.begin(), memory_, it->second);
+                return;
+            }
+
+            memory_.push_front(Entry { key, grid, cells, bytes });
+            memory_index_[key] = memory_.begin();
+            memory_bytes_ += bytes;
+
+            while (memory_bytes_ > memory_limit_) {
+                const Entry& last = memory_.back();
+                memory_bytes_ -= last.bytes;
+                memory_index_.erase(last.key);
+                memory_.pop_back();
+                stats_.evictions++;
+            }
+        }
+
+        Stats FrameCache::stats() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Stats stats = stats_;
+            stats.memory_bytes = memory_bytes_;
+            stats.disk_bytes = disk_bytes_;
+            return stats;
+        }
+
+        std::shared_ptr<FrameCache> get_cache(size_t memory_bytes, const std::string& folder, uint64_t disk_bytes) {
+            using Key = std::tuple<size_t, std::string, uint64_t>;
+
+            static std::mutex mutex;
+            static std::map<Key, std::shared_ptr<FrameCache>> caches;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            Key key { memory_bytes, folder, disk_bytes };
+            auto it = caches.find(key);
+            if (it != caches.end()) {
+                return it->second;
+            }
+
+            auto cache = std::make_shared<FrameCache>(memory_bytes, folder, disk_bytes);
+            caches.emplace(key, cache);
+            return cache;
+        }
+
+    } // namespace cache
+} // namespace rune
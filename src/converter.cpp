@@ -6,30 +6,86 @@
 #include "stb/stb_image_resize.h"
 #include "rune/ramp.hpp"
 #include "rune/converter.hpp"
+#include "rune/cache.hpp"
 #include "rune/writer.hpp"
+#include "rune/pipeline.hpp"
+#include "rune/kernel.hpp"
+#include "rune/profile.hpp"
+
+#include <charconv>
+#include <chrono>
+#include <deque>
+#include <mutex>
 
 namespace rune {
     namespace converter {
-        // Converts a video file to ASCII format by extracting frames and processing each one
-        void convert_video_to_ascii(const std::string& filename, int target_width, int target_fps, const std::string& output_folder, const rune::Ramp& ramp, float threshold) {
-            // Create temporary directory for extracted video frames
-            std::filesystem::path out_dir = "tmp";
-            std::filesystem::create_directories(out_dir);
-
-            // Clean out any existing frames from previous runs
-            for (auto& entry : std::filesystem::directory_iterator(out_dir)) {
-                std::filesystem::remove_all(entry.path());
+
+        namespace {
+
+            // True if `table` already holds the glyphs of `ramp`; compares without allocating
+            bool glyphs_match(const std::vector<std::string>& table, const rune::Ramp& ramp) {
+                if (table.size() != static_cast<size_t>(ramp.size())) return false;
+                for (int i = 0; i < ramp.size(); ++i) {
+                    if (table[i] != ramp.utf8(i)) return false;
+                }
+                return true;
             }
 
-            // Use ffmpeg to extract video frames at target FPS
-            std::string cmd =
-                "ffmpeg -y -i \"" + filename + "\" "
-                "-vf fps=" + std::to_string(target_fps) + " "
-                + out_dir.string() + "/frame_%05d.jpg";
+            // A converted frame at each rendition width, in rendition order
+            using FrameSet = std::vector<AsciiFrame>;
+
+            // Everything one width of a (possibly multi-width) video job writes
+            struct RenditionOutputs {
+                int width = 0;
+                std::string folder;
+                std::ofstream manifest_out;
+                writer::FrameOutputs outputs;
+                ImageBuffer manifest_buffer {};  // Size of the first frame's cell grid
+            };
+
+        } // namespace
+
+        // Converts a video file to ASCII format by streaming decoded frames out of ffmpeg
+        void convert_video_to_ascii(const std::string& filename, int target_width, int target_fps, const std::string& output_folder, const rune::Ramp& ramp, float threshold, const ConvertOptions& options) {
+            convert_video_to_ascii(filename, std::vector<int> { target_width }, target_fps, output_folder, ramp, threshold, options);
+        }
 
-                int ret = std::system(cmd.c_str());
-                if (ret != 0) {
-                    throw std::runtime_error("ffmpeg failed");
+        void convert_video_to_ascii(const std::string& filename, const std::vector<int>& target_widths, int target_fps, const std::string& output_folder, const rune::Ramp& ramp, float threshold, const ConvertOptions& options) {
+            VideoInfo info = probe_video(filename, target_fps);
+            std::FILE* pipe = open_video_frames(filename, target_fps, info);
+
+            bool converted;
+            try {
+                converted = convert_raw_stream_to_ascii(pipe, info.width, info.height, target_widths, target_fps, output_folder, ramp, threshold, options, info.frame_count);
+            } catch (...) {
+                pclose(pipe);
+                throw;
+            }
+
+            // When the outputs could not be opened the stream is left unread and ffmpeg
+            // dies on the closed pipe; that error was already reported
+            int ret = pclose(pipe);
+            if (converted && ret != 0) {
+                throw std::runtime_error("ffmpeg failed");
+            }
+        }
+
+        bool convert_raw_stream_to_ascii(std::FILE* in, int frame_width, int frame_height, int target_width, int target_fps, const std::string& output_folder, const rune::Ramp& ramp, float threshold, const ConvertOptions& options, int expected_frames) {
+            return convert_raw_stream_to_ascii(in, frame_width, frame_height, std::vector<int> { target_width }, target_fps, output_folder, ramp, threshold, options, expected_frames);
+        }
+
+        bool convert_raw_stream_to_ascii(std::FILE* in, int frame_width, int frame_height, const std::vector<int>& target_widths, int target_fps, const std::string& output_folder, const rune::Ramp& ramp, float threshold, const ConvertOptions& options, int expected_frames) {
+            if (frame_width <= 0 || frame_height <= 0) {
+                throw std::runtime_error("invalid raw frame size");
+            }
+
+            // Repeated widths would share a folder; the first occurrence wins
+            std::vector<int> widths;
+            for (int width : target_widths) {
+                if (std::find(widths.begin(), widths.end(), width) == widths.end()) widths.push_back(width);
+            }
+            if (widths.empty()) {
+                throw std::runtime_error("no target width");
             }
 
             std::filesystem::create_directories(output_folder);
@@ -37,75 +93,272 @@ namespace rune {
                 std::filesystem::remove_all(entry.path());
             }
 
-            std::ofstream manifest_out(output_folder + "/manifest.json");
-            if (!manifest_out) {
-                std::cerr << "failed to open output file\n";
-                return;
+            // One width writes straight into output_folder. A ladder writes each width to
+            // its own w<width>/ subfolder, laid out exactly like a single-width job, and
+            // lists them in a top-level manifest
+            const bool ladder = widths.size() > 1;
+
+            std::ofstream ladder_out;
+            if (ladder) {
+                ladder_out.open(output_folder + "/manifest.json");
+                if (!ladder_out) {
+                    std::cerr << "failed to open output file\n";
+                    return false;
+                }
             }
 
-            // gather all frames in the output directory
-            std::vector<std::filesystem::path> frames;
+            // One background writer serves every rendition; declared first so it outlives them
+            std::unique_ptr<io::WriteQueue> write_queue = writer::make_write_queue(options);
 
-            for (const auto& entry : std::filesystem::directory_iterator(out_dir)) {
-                frames.push_back(entry.path());
-            }
+            std::vector<std::unique_ptr<RenditionOutputs>> renditions;
+            for (int width : widths) {
+                auto rendition = std::make_unique<RenditionOutputs>();
+                rendition->width = width;
+                rendition->folder = ladder ? output_folder + "/w" + std::to_string(width) : output_folder;
+                std::filesystem::create_directories(rendition->folder);
 
-            std::sort(frames.begin(), frames.end());
+                rendition->manifest_out.open(rendition->folder + "/manifest.json");
+                if (!rendition->manifest_out) {
+                    std::cerr << "failed to open output file\n";
+                    return false;
+                }
 
-            int frame_count = frames.size();
+                if (!rendition->outputs.open(rendition->folder + "/" + "frames", target_fps, options, write_queue.get())) {
+                    return false;
+                }
+                renditions.push_back(std::move(rendition));
+            }
 
             int counter = 0;
 
-            bool manifest_written = false;
+            // Every rendition gets the same options, so they agree on whether HTML is needed
+            const bool with_html = renditions.front()->outputs.wants_html();
 
-            std::string filename_base = output_folder + "/" + "frames";
+            // Per-frame latency runs from the frame leaving the input to its last write.
+            // Frames reach the writer in read order, so start times form a queue.
+            profile::Profiler* profiler = profile::current();
+            std::mutex started_mutex;
+            std::deque<std::chrono::steady_clock::time_point> frame_started;
 
-            std::string filename_jsonl_gzip = filename_base + ".jsonl.gz";
-            gzFile gz = gzopen(filename_jsonl_gzip.c_str(), "wb");
+            auto read_frame = [&](ImageBuffer& image_buffer) {
+                bool ok;
+                {
+                    profile::Timer timer(profile::Stage::Input);
+                    ok = read_raw_frame(in, image_buffer);
+                }
+                if (ok && profiler) {
+                    std::lock_guard<std::mutex> lock(started_mutex);
+                    frame_started.push_back(std::chrono::steady_clock::now());
+                }
+                return ok;
+            };
 
-            if (!gz) {
-                std::cerr << "failed to open gzip file\n";
-                return;
+            // Writes one decoded frame's renditions to their outputs; always called in frame order
+            auto write_frame = [&](FrameSet& frames) {
+                for (size_t i = 0; i < renditions.size(); ++i) {
+                    RenditionOutputs& rendition = *renditions[i];
+
+                    // The frame count is only known once the stream ends, so the manifest is
+                    // written last from the dimensions of the first converted frame
+                    if (counter == 0) {
+                        rendition.manifest_buffer.width = frames[i].image_buffer.width;
+                        rendition.manifest_buffer.height = frames[i].image_buffer.height;
+                        rendition.manifest_buffer.channels = frames[i].image_buffer.channels;
+                    }
+
+                    rendition.outputs.write_frame(frames[i]);
+                }
+
+                if (profiler) {
+                    std::chrono::steady_clock::time_point started;
+                    {
+                        std::lock_guard<std::mutex> lock(started_mutex);
+                        started = frame_started.front();
+                        frame_started.pop_front();
+                    }
+                    profiler->frame_done(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count());
+                }
+
+                counter++;
+                if (!options.quiet) print_progress(counter, std::max(counter, expected_frames));
+            };
+
+            // Built (or fetched from the cache) once per job, shared by every worker
+            std::shared_ptr<const lut::ColorLut> table = lut_for(ramp, threshold, options);
+            std::shared_ptr<cache::FrameCache> frame_cache = cache_for(options);
+            const int threads = options.threads;
+
+            // Resizes and maps one decoded frame at every width. Each width keeps its own
+            // context, so its downsampling spans are built once and reused
+            auto convert = [&](const ImageBuffer& image_buffer, std::vector<FrameContext>& contexts, FrameSet& frames) {
+                contexts.resize(renditions.size());
+                frames.resize(renditions.size());
+                for (size_t i = 0; i < renditions.size(); ++i) {
+                    contexts[i].cache = frame_cache.get();
+                    convert_frame_to_ascii(image_buffer, renditions[i]->width, ramp, threshold, table.get(), contexts[i], frames[i]);
+                    if (with_html) add_html(frames[i], renditions[i]->outputs.palette());
+                }
+            };
+
+            // Only one decoded frame is held per in-flight job, so memory stays flat
+            // regardless of the length of the stream
+            ImageBuffer frame_buffer;
+            frame_buffer.width = frame_width;
+            frame_buffer.height = frame_height;
+            frame_buffer.channels = 3;
+
+            if (threads <= 1) {
+                // The contexts and frames are reused, so after the first frame the
+                // loop runs without heap allocations
+                std::vector<FrameContext> contexts;
+                FrameSet frames;
+
+                while (read_frame(frame_buffer)) {
+                    convert(frame_buffer, contexts, frames);
+                    write_frame(frames);
+                }
+            } else {
+                // Frames are converted concurrently and reordered before writing,
+                // so the output is byte-identical to the single-threaded path (gzip
+                // deflates on one thread unless --gzip-threads asks for more).
+                // Two frames per worker keeps every core busy while the writer drains.
+                // Decode buffers, frame sets and their conversion scratch stay in the
+                // pipeline's slots and are reused in turn, so the threaded loop does not
+                // allocate either once every slot has carried a frame
+                struct FrameJob {
+                    std::vector<FrameContext> contexts;
+                    FrameSet frames;
+                };
+
+                pipeline::OrderedPipeline<ImageBuffer, FrameJob> frame_pipeline(threads, static_cast<size_t>(threads) * 2,
+                    [&](ImageBuffer& image_buffer, FrameJob& job) { convert(image_buffer, job.contexts, job.frames); },
+                    [&](FrameJob& job) { write_frame(job.frames); });
+
+                while (read_frame(frame_buffer)) {
+                    // Hands the frame over and gets back the buffer of an earlier one
+                    frame_pipeline.submit(frame_buffer);
+                    frame_buffer.width = frame_width;
+                    frame_buffer.height = frame_height;
+                    frame_buffer.channels = 3;
+                }
+                frame_pipeline.finish();
             }
 
-            std::string filename_jsonl = filename_base + ".jsonl";
-            std::ofstream j_data_out(filename_jsonl, std::ios::out | std::ios::app);
-            if (!j_data_out) {
-                std::cerr << "failed to open output file\n";
-                return;
+            for (auto& rendition : renditions) {
+                rendition->outputs.close();
             }
 
-            std::string filename_html = filename_base + ".txt";
-            std::ofstream h_data_out(filename_html, std::ios::out | std::ios::app);
-            if (!h_data_out) {
-                std::cerr << "failed to open output file\n";
-                return;
+            if (counter == 0) {
+                return true;
             }
 
-            for (auto& frame : frames) {
-                AsciiFrame ascii_frame = convert_frame_to_ascii(frame.string(), target_width, ramp, threshold);
+            const std::string type = "video";
+            const int keyframe_interval = (options.format == OutputFormat::Jsonl && options.keyframe_interval > 1) ? options.keyframe_interval : 0;
+            const std::string stylesheet = renditions.front()->outputs.palette() ? "frames.css" : "";
+
+            std::vector<writer::Rendition> ladder_entries;
+            for (auto& rendition : renditions) {
+                writer::write_manifest(rendition->manifest_out, rendition->manifest_buffer, type, target_fps, counter, keyframe_interval, stylesheet, rendition->outputs.playlist_name());
+
+                if (ladder) {
+                    // The main frame files' size stands in for the rendition's bandwidth
+                    ladder_entries.push_back(writer::Rendition {
+                        rendition->manifest_buffer.width,
+                        rendition->manifest_buffer.height,
+                        "w" + std::to_string(rendition->width),
+                        rendition->outputs.main_bytes()
+                    });
+                }
+            }
 
-                add_html(ascii_frame);
+            if (ladder) {
+                writer::write_ladder_manifest(ladder_out, type, target_fps, counter, ladder_entries);
+            }
+            return true;
+        }
 
-                if (!manifest_written) {
-                    const std::string type = "video";
-                    writer::write_manifest(manifest_out, ascii_frame.image_buffer, type, target_fps, frame_count);
-                    manifest_written = true;
-                }
+        bool read_raw_frame(std::FILE* in, ImageBuffer& image_buffer) {
+            const size_t frame_size = static_cast<size_t>(image_buffer.width) * image_buffer.height * image_buffer.channels;
+            image_buffer.pixels.resize(frame_size);
+
+            size_t read = 0;
+            while (read < frame_size) {
+                size_t n = std::fread(image_buffer.pixels.data() + read, 1, frame_size - read, in);
+                if (n == 0) break;
+                read += n;
+            }
 
-                writer::write_cells(j_data_out, ascii_frame.image_buffer, ascii_frame.cells);
-                writer::write_cells_gzip(gz, ascii_frame.image_buffer, ascii_frame.cells);
-                writer::write_html(h_data_out, ascii_frame.html);
+            // A trailing partial frame means the stream was cut short; it is dropped
+            return read == frame_size;
+        }
 
-                counter++;
-                print_progress(counter, frame_count);
+        std::FILE* open_video_frames(const std::string& filename, int target_fps, const VideoInfo& info) {
+            // ffmpeg decodes and resamples to the target fps, then writes packed RGB24
+            // frames to stdout; nothing touches the disk between decode and conversion.
+            // The scale pins every frame to the probed size, so read_raw_frame splits the
+            // stream at frame boundaries even if ffmpeg rotates or resizes on its own
+            std::string cmd =
+                "ffmpeg -v error -i \"" + filename + "\" "
+                "-vf fps=" + std::to_string(target_fps) + ",scale=" + std::to_string(info.width) + ":" + std::to_string(info.height) + " "
+                "-f rawvideo -pix_fmt rgb24 -";
+
+            std::FILE* pipe = popen(cmd.c_str(), "r");
+            if (!pipe) {
+                throw std::runtime_error("ffmpeg failed");
             }
+            return pipe;
+        }
+
+        VideoInfo probe_video(const std::string& filename, int target_fps) {
+            std::string cmd =
+                "ffprobe -v error -select_streams v:0 "
+                "-show_entries stream=width,height:stream_tags=rotate:stream_side_data=rotation:format=duration "
+                "-of default=noprint_wrappers=1 \"" + filename + "\"";
 
-            gzclose(gz);
+            std::FILE* pipe = popen(cmd.c_str(), "r");
+            if (!pipe) {
+                throw std::runtime_error("ffprobe failed");
+            }
+
+            VideoInfo info {};
+            double duration = 0.0;
+            int rotation = 0;
+
+            char line[256];
+            while (std::fgets(line, sizeof(line), pipe)) {
+                std::string entry(line);
+                size_t eq = entry.find('=');
+                if (eq == std::string::npos) continue;
+
+                std::string key = entry.substr(0, eq);
+                std::string value = entry.substr(eq + 1);
+                try {
+                    if (key == "width") info.width = std::stoi(value);
+                    else if (key == "height") info.height = std::stoi(value);
+                    else if (key == "duration") duration = std::stod(value);
+                    // Older ffmpeg reports rotation as a stream tag, newer as display matrix side data
+                    else if (key == "TAG:rotate" || key == "rotation") rotation = std::stoi(value);
+                } catch (const std::exception&) {
+                    // ffprobe prints N/A for unknown values
+                }
+            }
+
+            if (pclose(pipe) != 0 || info.width <= 0 || info.height <= 0) {
+                throw std::runtime_error("ffprobe failed");
+            }
+
+            // ffmpeg auto-rotates such videos, so quarter turns swap the decoded frame's sides
+            if (std::abs(rotation) % 180 == 90) {
+                std::swap(info.width, info.height);
+            }
 
+            info.frame_count = static_cast<int>(std::ceil(duration * target_fps));
+            return info;
         }
 
-        void convert_image_to_ascii(const std::string& filename, int target_width, const std::string& output_folder, const rune::Ramp& ramp, float threshold) {
+        void convert_image_to_ascii(const std::string& filename, int target_width, const std::string& output_folder, const rune::Ramp& ramp, float threshold, const ConvertOptions& options) {
+            const auto started = std::chrono::steady_clock::now();
+
             std::filesystem::create_directories(output_folder);
             for (auto& entry : std::filesystem::directory_iterator(output_folder)) {
                 std::filesystem::remove_all(entry.path());
@@ -119,116 +372,138 @@ namespace rune {
 
             std::string filename_base = output_folder + "/" + "frame";
 
-            std::string filename_jsonl = filename_base + ".jsonl";
-            std::ofstream j_data_out(filename_jsonl, std::ios::out | std::ios::app);
-            if (!j_data_out) {
-                std::cerr << "failed to open output file\n";
+            // A still is a handful of small files, written inline rather than through an I/O thread
+            writer::FrameOutputs outputs;
+            if (!outputs.open(filename_base, 0, options)) {
                 return;
             }
 
-            std::string filename_jsonl_gzip = filename_base + ".jsonl.gz";
-            gzFile gz = gzopen(filename_jsonl_gzip.c_str(), "wb");
-
-            if (!gz) {
-                std::cerr << "failed to open gzip file\n";
-                return;
-            }
+            std::shared_ptr<const lut::ColorLut> table = lut_for(ramp, threshold, options);
+            std::shared_ptr<cache::FrameCache> frame_cache = cache_for(options);
 
-            std::string filename_html = filename_base + ".txt";
-            std::ofstream h_data_out(filename_html, std::ios::out | std::ios::app);
-            if (!h_data_out) {
-                std::cerr << "failed to open output file\n";
-                return;
+            ImageBuffer image_buffer;
+            {
+                profile::Timer timer(profile::Stage::Decode);
+                image_buffer = load_image_pixels(filename);
             }
 
-            AsciiFrame ascii_frame = convert_frame_to_ascii(filename, target_width, ramp, threshold);
+            FrameContext context;
+            context.cache = frame_cache.get();
+            AsciiFrame ascii_frame;
+            convert_frame_to_ascii(image_buffer, target_width, ramp, threshold, table.get(), context, ascii_frame);
 
-            add_html(ascii_frame);
+            if (outputs.wants_html()) add_html(ascii_frame, outputs.palette());
 
             const std::string type = "image";
 
-            writer::write_manifest(manifest_out, ascii_frame.image_buffer, type, 0, 1);
+            const std::string stylesheet = outputs.palette() ? "frame.css" : "";
+            writer::write_manifest(manifest_out, ascii_frame.image_buffer, type, 0, 1, 0, stylesheet);
 
-            writer::write_cells(j_data_out, ascii_frame.image_buffer, ascii_frame.cells);
-            writer::write_cells_gzip(gz, ascii_frame.image_buffer, ascii_frame.cells);
-            writer::write_html(h_data_out, ascii_frame.html);
+            outputs.write_frame(ascii_frame);
+            outputs.close();
 
-            gzclose(gz);
+            if (profile::Profiler* profiler = profile::current()) {
+                profiler->frame_done(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count());
+            }
         }
 
 
-        void add_html(AsciiFrame& ascii_frame) {
-            const int width = ascii_frame.image_buffer.width;
+        void add_html(AsciiFrame& ascii_frame, const palette::Palette* palette) {
+            profile::Timer timer(profile::Stage::Html);
             const auto& cells = ascii_frame.cells;
+            const int width = cells.cols;
 
-            std::string html;
+            // Written in place so a reused frame keeps the string's capacity
+            std::string& html = ascii_frame.html;
+            html.clear();
             html.reserve(cells.size() * 6);
 
-            std::string lastGlyph = "";
+            // Glyphs come pre-escaped from the compiled ramp; a frame built without
+            // one has its table escaped here
+            const rune::Ramp* ramp = ascii_frame.ramp;
+            std::vector<EncodedGlyph> escaped;
+            if (!ramp) {
+                for (const std::string& glyph : cells.glyph_table) escaped.push_back(glyph_encoding::html(glyph));
+            }
+            auto glyph_html = [&](int glyph) { return ramp ? ramp->html(glyph) : escaped[glyph].view(); };
+
+            if (palette) {
+                // Runs only break where the palette entry changes; the glyph inside a run may vary
+                int last_entry = -1;
+
+                for (size_t i = 0; i < cells.size(); ++i) {
+                    const bool row_start = i != 0 && i % width == 0;
+                    const int entry = palette->index(cells.h[i], cells.s[i], cells.l[i]);
+
+                    if (entry != last_entry || row_start) {
+                        if (last_entry >= 0) html += "</span>";
+                        if (row_start) html += "\\n";
+
+                        html += "<span class=\"";
+                        html += palette->css_class(entry);
+                        html += "\">";
+                        last_entry = entry;
+                    }
+                    html += glyph_html(cells.glyphs[i]);
+                }
+                if (last_entry >= 0) html += "</span>";
+                return;
+            }
+
+            int lastGlyph = -1;
             int lastH = -1, lastS = -1, lastL = -1;
-            std::string run;
 
-            auto flush_run = [&]() {
-                if (run.empty()) return;
+            // A run's opening tag only depends on its first cell, so it is written
+            // straight away and the glyphs follow it without an intermediate buffer
+            auto open_run = [&](int glyph, int h, int s, int l) {
+                lastGlyph = glyph;
+                lastH = h;
+                lastS = s;
+                lastL = l;
 
+                char number[16];
                 html += "<span style=\"color:hsl(";
-                html += std::to_string(lastH);
+                html.append(number, std::to_chars(number, number + sizeof(number), h).ptr);
                 html += ",";
-                html += std::to_string(lastS);
+                html.append(number, std::to_chars(number, number + sizeof(number), s).ptr);
                 html += "%,";
-                html += std::to_string(lastL);
+                html.append(number, std::to_chars(number, number + sizeof(number), l).ptr);
                 html += "%)\">";
-                html += run;
-                html += "</span>";
+            };
 
-                run.clear();
+            auto close_run = [&]() {
+                if (lastGlyph < 0) return;
+                html += "</span>";
             };
 
             for (size_t i = 0; i < cells.size(); ++i) {
 
 
                 if (i != 0 && i % width == 0) {
-                    flush_run();
+                    close_run();
                     html += "\\n";
-                    lastGlyph = "";
+                    lastGlyph = -1;
                     lastH = lastS = lastL = -1;
                 }
 
-                const rune::Cell& cell = cells[i];
-
-                const std::string& glyph = cell.glyph;
-                int h = static_cast<int>(cell.h);        // degrees
-                int s = static_cast<int>(cell.s * 100);  // %
-                int l = static_cast<int>(cell.l * 100);  // %
-
-
-                if (lastGlyph.empty()) {
-                    lastGlyph = glyph;
-                    lastH = h;
-                    lastS = s;
-                    lastL = l;
-                    run += glyph;
-                    continue;
-                }
+                int glyph = cells.glyphs[i];
+                int h = cells.h[i];  // degrees
+                int s = cells.s[i];  // %
+                int l = cells.l[i];  // %
 
 
                 if (glyph == lastGlyph && h == lastH && s == lastS && l == lastL) {
-                    run += glyph;
+                    html += glyph_html(glyph);
                     continue;
                 }
 
-                flush_run();
-                lastGlyph = glyph;
-                lastH = h;
-                lastS = s;
-                lastL = l;
-                run += glyph;
+                close_run();
+                open_run(glyph, h, s, l);
+                html += glyph_html(glyph);
             }
 
 
-            flush_run();
-
-            ascii_frame.html = std::move(html);
+            close_run();
         }
 
 
@@ -250,16 +525,47 @@ namespace rune {
         }
 
 
-        AsciiFrame convert_frame_to_ascii(const std::string& filename, int target_width, const rune::Ramp& ramp, float threshold) {
+        AsciiFrame convert_frame_to_ascii(const std::string& filename, int target_width, const rune::Ramp& ramp, float threshold, const lut::ColorLut* lut) {
+            ImageBuffer image_buffer;
+            {
+                profile::Timer timer(profile::Stage::Decode);
+                image_buffer = load_image_pixels(filename);
+            }
+            return convert_frame_to_ascii(image_buffer, target_width, ramp, threshold, lut);
+        }
+
+        AsciiFrame convert_frame_to_ascii(const ImageBuffer& image_buffer, int target_width, const rune::Ramp& ramp, float threshold, const lut::ColorLut* lut) {
             AsciiFrame ascii_frame;
-            ImageBuffer image_buffer = load_image_pixels(filename);
-            ImageBuffer resized_image_buffer = resize_image_pixels(image_buffer, target_width);
-            std::vector<rune::Cell> cells = pixels_to_cells(resized_image_buffer, ramp, threshold);
-            ascii_frame.image_buffer = resized_image_buffer;
-            ascii_frame.cells = cells;
+            FrameContext context;
+            convert_frame_to_ascii(image_buffer, target_width, ramp, threshold, lut, context, ascii_frame);
             return ascii_frame;
         }
 
+        void convert_frame_to_ascii(ImageView image, int target_width, const rune::Ramp& ramp, float threshold, const lut::ColorLut* lut, FrameContext& context, AsciiFrame& ascii_frame) {
+            ascii_frame.ramp = &ramp;
+
+            cache::Key key;
+            if (context.cache) {
+                profile::Timer timer(profile::Stage::Cache);
+                key = cache::make_key(image, target_width, ramp, threshold, lut ? lut->bits() : 0);
+                if (context.cache->lookup(key, ascii_frame.image_buffer, ascii_frame.cells)) {
+                    return;
+                }
+            }
+            {
+                profile::Timer timer(profile::Stage::Resize);
+                downsample_to_grid(image, target_width, cell_rows(image, target_width), ascii_frame.image_buffer, context.downsample);
+            }
+            {
+                profile::Timer timer(profile::Stage::Cells);
+                pixels_to_cells(ascii_frame.image_buffer, ramp, threshold, lut, ascii_frame.cells);
+            }
+            if (context.cache) {
+                profile::Timer timer(profile::Stage::Cache);
+                context.cache->insert(key, ascii_frame.image_buffer, ascii_frame.cells);
+            }
+        }
+
         ImageBuffer load_image_pixels(const std::string& filename) {
             ImageBuffer image_buffer;
             int width, height, channels;
@@ -289,6 +595,38 @@ namespace rune {
             return buffer;
         }
 
+        ImageBuffer decode_image_pixels(const uint8_t* data, size_t size) {
+            int width, height, channels;
+
+            unsigned char* raw_pixels = stbi_load_from_memory(
+                data,
+                static_cast<int>(size),
+                &width,
+                &height,
+                &channels,
+                3
+            );
+
+            if (!raw_pixels) {
+                throw std::runtime_error("Failed to decode image");
+            }
+
+            ImageBuffer buffer;
+            buffer.width = width;
+            buffer.height = height;
+            buffer.channels = 3;
+            buffer.pixels.assign(raw_pixels, raw_pixels + static_cast<size_t>(width) * height * 3);
+
+            stbi_image_free(raw_pixels);
+
+            return buffer;
+        }
+
+        bool probe_image(const uint8_t* data, size_t size, int& width, int& height) {
+            int channels;
+            return stbi_info_from_memory(data, static_cast<int>(size), &width, &height, &channels) != 0;
+        }
+
         ImageBuffer resize_image_pixels(const ImageBuffer& image_buffer, int target_width) {
             ImageBuffer resized_image_buffer;
             int new_height = image_buffer.height * target_width / image_buffer.width;
@@ -312,60 +650,180 @@ namespace rune {
             return resized_image_buffer;
         }
 
-        std::vector<rune::Cell> pixels_to_cells(const ImageBuffer& image_buffer, const rune::Ramp& ramp, float threshold) {
-
-            std::vector<rune::Cell> cells;
-
-            // Parse UTF-8 characters from ramp into a vector
-            std::vector<std::string> ramp_chars;
-            size_t i = 0;
-            while (i < ramp.chars.size()) {
-                unsigned char c = ramp.chars[i];
-                int char_len = 1;
-                
-                // Determine UTF-8 character length
-                if ((c & 0x80) == 0) {
-                    char_len = 1; // ASCII
-                } else if ((c & 0xE0) == 0xC0) {
-                    char_len = 2; // 2-byte UTF-8
-                } else if ((c & 0xF0) == 0xE0) {
-                    char_len = 3; // 3-byte UTF-8
-                } else if ((c & 0xF8) == 0xF0) {
-                    char_len = 4; // 4-byte UTF-8
+        int cell_rows(ImageView image, int target_width) {
+            const int new_height = image.height * target_width / image.width;
+            return std::max(1, (new_height + 1) / 2);
+        }
+
+        ImageBuffer downsample_to_grid(const ImageBuffer& image_buffer, int cols, int rows) {
+            ImageBuffer grid;
+            DownsampleScratch scratch;
+            downsample_to_grid(image_buffer, cols, rows, grid, scratch);
+            return grid;
+        }
+
+        void downsample_to_grid(ImageView image, int cols, int rows, ImageBuffer& grid, DownsampleScratch& scratch) {
+            const int width = image.width;
+            const int height = image.height;
+            const int channels = image.channels;
+
+            using Span = DownsampleScratch::Span;
+
+            // Per-axis spans in units of 1/cells: pixel x covers [x*cells, (x+1)*cells) and
+            // cell c covers [c*extent, (c+1)*extent), so every overlap is an integer weight
+            // and the weights of one cell add up to `extent`
+            auto build_spans = [](int extent, int cells, std::vector<Span>& spans, std::vector<uint32_t>& weights) {
+                spans.resize(cells);
+                weights.clear();
+                for (int c = 0; c < cells; ++c) {
+                    const int64_t lo = static_cast<int64_t>(c) * extent;
+                    const int64_t hi = static_cast<int64_t>(c + 1) * extent;
+                    const int first = static_cast<int>(lo / cells);
+                    const int last = static_cast<int>((hi + cells - 1) / cells);
+
+                    spans[c] = Span { first, last - first, weights.size() };
+                    for (int x = first; x < last; ++x) {
+                        const int64_t a = std::max<int64_t>(static_cast<int64_t>(x) * cells, lo);
+                        const int64_t b = std::min<int64_t>(static_cast<int64_t>(x + 1) * cells, hi);
+                        weights.push_back(static_cast<uint32_t>(b - a));
+                    }
                 }
-                
-                ramp_chars.push_back(std::string(ramp.chars.substr(i, char_len)));
-                i += char_len;
-            }
+            };
 
-            for (int y = 0; y < image_buffer.height; y+=2) {
-                for (int x = 0; x < image_buffer.width; x++) {
-                    rune::Cell cell;
-                    int idx = (y * image_buffer.width + x) * image_buffer.channels;
-                    int r = image_buffer.pixels[idx];
-                    int g = image_buffer.pixels[idx + 1];
-                    int b = image_buffer.pixels[idx + 2];
+            if (scratch.width != width || scratch.cols != cols) {
+                build_spans(width, cols, scratch.x_spans, scratch.x_weights);
+                scratch.width = width;
+                scratch.cols = cols;
+            }
+            if (scratch.height != height || scratch.rows != rows) {
+                build_spans(height, rows, scratch.y_spans, scratch.y_weights);
+                scratch.height = height;
+                scratch.rows = rows;
+            }
+            const std::vector<Span>& x_spans = scratch.x_spans;
+            const std::vector<Span>& y_spans = scratch.y_spans;
+            const std::vector<uint32_t>& x_weights = scratch.x_weights;
+            const std::vector<uint32_t>& y_weights = scratch.y_weights;
+
+            grid.width = cols;
+            grid.height = rows;
+            grid.channels = channels;
+            grid.pixels.resize(static_cast<size_t>(cols) * rows * channels);
+
+            // Horizontal sums of one source row (each at most 255 * width) and their
+            // vertically weighted totals for the current cell row (at most 255 * width * height)
+            std::vector<uint32_t>& row_sums = scratch.row_sums;
+            std::vector<uint64_t>& totals = scratch.totals;
+            row_sums.resize(static_cast<size_t>(cols) * channels);
+            totals.resize(static_cast<size_t>(cols) * channels);
+            const uint64_t area = static_cast<uint64_t>(width) * height;
+
+            for (int r = 0; r < rows; ++r) {
+                std::fill(totals.begin(), totals.end(), 0);
+
+                const Span& ys = y_spans[r];
+                for (int k = 0; k < ys.count; ++k) {
+                    const uint8_t* src = image.row(ys.first + k);
+                    const uint64_t wy = y_weights[ys.weights + k];
+
+                    for (int c = 0; c < cols; ++c) {
+                        const Span& xs = x_spans[c];
+                        const uint8_t* p = src + static_cast<size_t>(xs.first) * channels;
+                        const uint32_t* w = x_weights.data() + xs.weights;
+
+                        uint32_t* sum = row_sums.data() + static_cast<size_t>(c) * channels;
+                        for (int ch = 0; ch < channels; ++ch) sum[ch] = 0;
+                        for (int i = 0; i < xs.count; ++i, p += channels) {
+                            for (int ch = 0; ch < channels; ++ch) sum[ch] += w[i] * p[ch];
+                        }
+                    }
+
+                    for (size_t i = 0; i < totals.size(); ++i) {
+                        totals[i] += wy * row_sums[i];
+                    }
+                }
 
-                    HSL hsl = rgb_to_hsl(r, g, b);
+                uint8_t* dst = grid.pixels.data() + static_cast<size_t>(r) * cols * channels;
+                for (size_t i = 0; i < totals.size(); ++i) {
+                    dst[i] = static_cast<uint8_t>((totals[i] + area / 2) / area);
+                }
+            }
+        }
 
-                    // Apply threshold: if lightness > threshold, set to white (1.0), else keep original
-                    float adjusted_l = (hsl.l > threshold) ? 1.0f : hsl.l;
 
-                    float t = std::clamp(adjusted_l, 0.0f, 1.0f);
+        std::vector<std::string> split_glyphs(const rune::Ramp& ramp) {
+            std::vector<std::string> glyphs;
+            glyphs.reserve(ramp.size());
+            for (int i = 0; i < ramp.size(); ++i) {
+                glyphs.emplace_back(ramp.utf8(i));
+            }
+            return glyphs;
+        }
 
-                    int ascii_index = static_cast<int>(std::round(t * (ramp_chars.size() - 1)));
+        std::shared_ptr<const lut::ColorLut> lut_for(const rune::Ramp& ramp, float threshold, const ConvertOptions& options) {
+            if (options.lut_bits <= 0) {
+                return nullptr;
+            }
+            return lut::get_lut(ramp.size(), threshold, options.lut_bits);
+        }
 
-                    cell.glyph = ramp_chars[ascii_index];
-                    cell.h = hsl.h; // degrees
-                    cell.s = hsl.s; // ratio
-                    cell.l = adjusted_l; // ratio (with threshold applied)
-                    cells.push_back(cell);
-                }
+        std::shared_ptr<cache::FrameCache> cache_for(const ConvertOptions& options) {
+            if (options.cache_memory_mb <= 0 && options.cache_dir.empty()) {
+                return nullptr;
             }
+            const size_t memory_bytes = static_cast<size_t>(std::max(0, options.cache_memory_mb)) << 20;
+            const uint64_t disk_bytes = static_cast<uint64_t>(std::max(0, options.cache_disk_mb)) << 20;
+            return cache::get_cache(memory_bytes, options.cache_dir, disk_bytes);
+        }
 
+        CellBuffer pixels_to_cells(const ImageBuffer& image_buffer, const rune::Ramp& ramp, float threshold, const lut::ColorLut* lut) {
+            CellBuffer cells;
+            pixels_to_cells(image_buffer, ramp, threshold, lut, cells);
             return cells;
         }
 
+        void pixels_to_cells(const ImageBuffer& image_buffer, const rune::Ramp& ramp, float threshold, const lut::ColorLut* lut, CellBuffer& cells) {
+
+            // Copy the ramp's glyphs into the glyph table, unless it already holds them
+            if (!glyphs_match(cells.glyph_table, ramp)) {
+                cells.glyph_table = split_glyphs(ramp);
+            }
+
+            // One pixel per cell; the glyph aspect ratio is already folded into the grid
+            cells.resize(image_buffer.width, image_buffer.height);
+
+            const int last_glyph = ramp.size() - 1;
+
+            // Each row goes through the lookup table or the vectorized kernel in one pass
+            for (int y = 0; y < image_buffer.height; ++y) {
+                const size_t row = static_cast<size_t>(y) * cells.cols;
+                const uint8_t* row_pixels = image_buffer.pixels.data() + static_cast<size_t>(y) * image_buffer.width * image_buffer.channels;
+
+                if (lut) {
+                    lut->map_row(
+                        row_pixels,
+                        image_buffer.width,
+                        image_buffer.channels,
+                        cells.glyphs.data() + row,
+                        cells.h.data() + row,
+                        cells.s.data() + row,
+                        cells.l.data() + row);
+                    continue;
+                }
+
+                kernel::map_row(
+                    row_pixels,
+                    image_buffer.width,
+                    image_buffer.channels,
+                    threshold,
+                    last_glyph,
+                    cells.glyphs.data() + row,
+                    cells.h.data() + row,
+                    cells.s.data() + row,
+                    cells.l.data() + row);
+            }
+        }
+
 
         HSL rgb_to_hsl(int r, int g, int b) {
             HSL out;
@@ -0,0 +1,306 @@
+#include "rune/gzip.hpp"
+#include "rune/io.hpp"
+#include "rune/pipeline.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+
+namespace rune {
+    namespace writer {
+
+        namespace {
+
+            // Deflate's maximum back-reference distance
+            constexpr size_t WINDOW_SIZE = 32 * 1024;
+
+            void put_u32(unsigned char* p, uint32_t v) {
+                for (int i = 0; i < 4; ++i) p[i] = static_cast<unsigned char>(v >> (8 * i));
+            }
+
+        } // namespace
+
+        // One compressed block of a parallel member, with what is needed to stitch it in
+        struct GzipWriter::Block {
+            std::vector<unsigned char> data;
+            uLong crc = 0;
+            size_t raw_size = 0;
+        };
+
+        namespace {
+
+            // What a worker needs to compress one block on its own
+            struct BlockInput {
+                std::vector<unsigned char> data;
+                std::vector<unsigned char> dictionary;  // Up to 32 KiB of input preceding data
+                int level = Z_DEFAULT_COMPRESSION;
+                bool last = false;
+            };
+
+        } // namespace
+
+        struct GzipWriter::BlockPipeline {
+            pipeline::OrderedPipeline<BlockInput, Block> blocks;
+            BlockInput next;  // Filled by submit_block(); holds a recycled input between blocks
+
+            BlockPipeline(int threads, GzipWriter& gz)
+                : blocks(threads, static_cast<size_t>(threads) * 2, compress_block, [&gz](Block& block) {
+                    gz.write_file(block.data.data(), block.data.size());
+                    gz.member_crc_ = crc32_combine(gz.member_crc_, block.crc, static_cast<z_off_t>(block.raw_size));
+                    gz.member_size_ += block.raw_size;
+                }) {}
+
+            static void compress_block(BlockInput& input, Block& block) {
+                block.raw_size = input.data.size();
+                block.crc = crc32(crc32(0L, Z_NULL, 0), input.data.data(), static_cast<uInt>(input.data.size()));
+
+                // Raw deflate (negative window bits): the gzip wrapper is written once per member
+                z_stream stream {};
+                if (deflateInit2(&stream, input.level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+                    throw std::runtime_error("deflateInit2 failed");
+                }
+                if (!input.dictionary.empty()) {
+                    deflateSetDictionary(&stream, input.dictionary.data(), static_cast<uInt>(input.dictionary.size()));
+                }
+
+                // Non-final blocks end on a byte boundary (sync flush) so they concatenate
+                block.data.resize(deflateBound(&stream, static_cast<uLong>(input.data.size())) + 16);
+                stream.next_in = input.data.data();
+                stream.avail_in = static_cast<uInt>(input.data.size());
+                stream.next_out = block.data.data();
+                stream.avail_out = static_cast<uInt>(block.data.size());
+
+                int ret = deflate(&stream, input.last ? Z_FINISH : Z_SYNC_FLUSH);
+                const bool done = input.last ? ret == Z_STREAM_END : (ret == Z_OK && stream.avail_in == 0 && stream.avail_out != 0);
+                block.data.resize(block.data.size() - stream.avail_out);
+                deflateEnd(&stream);
+
+                if (!done) {
+                    throw std::runtime_error("deflate failed");
+                }
+            }
+        };
+
+        GzipWriter::GzipWriter() = default;
+
+        GzipWriter::~GzipWriter() {
+            // Callers that care about write errors close() explicitly; here they can only be logged
+            try {
+                close();
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << "\n";
+            }
+        }
+
+        bool GzipWriter::open(const std::string& path, int level, int threads, size_t block_size, io::WriteQueue* queue) {
+            close();
+
+            if (queue) {
+                queue_file_ = queue->open(path, true);
+                if (queue_file_ < 0) {
+                    return false;
+                }
+                queue_ = queue;
+            } else {
+                file_ = std::fopen(path.c_str(), "wb");
+                if (!file_) {
+                    return false;
+                }
+            }
+
+            level_ = level;
+            threads_ = threads;
+            block_size_ = block_size == 0 ? DEFAULT_BLOCK_SIZE : block_size;
+            compressed_ = 0;
+            uncompressed_ = 0;
+            out_.resize(1 << 16);
+            return true;
+        }
+
+        void GzipWriter::write(const void* data, size_t size) {
+            if (!is_open()) {
+                throw std::runtime_error("gzip writer is not open");
+            }
+
+            if (threads_ > 1) {
+                if (!member_open_) {
+                    begin_parallel_member();
+                }
+
+                const unsigned char* bytes = static_cast<const unsigned char*>(data);
+                while (size > 0) {
+                    const size_t take = std::min(size, block_size_ - pending_.size());
+                    pending_.insert(pending_.end(), bytes, bytes + take);
+                    bytes += take;
+                    size -= take;
+                    uncompressed_ += take;
+
+                    if (pending_.size() == block_size_) {
+                        submit_block(false);
+                    }
+                }
+                return;
+            }
+
+            if (!member_open_) {
+                stream_ = z_stream {};
+                // 15 window bits + 16 selects the gzip wrapper, matching gzopen's output
+                if (deflateInit2(&stream_, level_, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+                    throw std::runtime_error("deflateInit2 failed");
+                }
+                member_open_ = true;
+            }
+
+            deflate_input(data, size, Z_NO_FLUSH);
+            uncompressed_ += size;
+        }
+
+        void GzipWriter::start_member() {
+            if (!member_open_) {
+                return;
+            }
+
+            if (threads_ > 1) {
+                finish_parallel_member();
+                return;
+            }
+
+            deflate_input(nullptr, 0, Z_FINISH);
+            deflateEnd(&stream_);
+            member_open_ = false;
+        }
+
+        void GzipWriter::close() {
+            if (!is_open()) {
+                return;
+            }
+
+            // The file is released even when finishing the member fails, so a failed
+            // close is reported once and leaves the writer closed
+            std::exception_ptr error;
+            try {
+                // An empty file still gets one (empty) member so it is valid gzip
+                if (!member_open_ && compressed_ == 0) {
+                    write(nullptr, 0);
+                }
+                start_member();
+            } catch (...) {
+                error = std::current_exception();
+                if (member_open_ && threads_ <= 1) deflateEnd(&stream_);
+                member_open_ = false;
+            }
+
+            // Joins the deflate workers; any error they hit was already rethrown above
+            pipeline_.reset();
+
+            bool ok;
+            if (queue_) {
+                ok = queue_->close(queue_file_);
+                queue_ = nullptr;
+                queue_file_ = -1;
+            } else {
+                // Buffered output is only flushed here, so a full disk may first show up now
+                ok = std::fclose(file_) == 0;
+                file_ = nullptr;
+            }
+
+            if (error) {
+                std::rethrow_exception(error);
+            }
+            if (!ok) {
+                throw std::runtime_error("gzip write failed");
+            }
+        }
+
+        void GzipWriter::deflate_input(const void* data, size_t size, int flush) {
+            stream_.next_in = static_cast<Bytef*>(const_cast<void*>(data));
+            stream_.avail_in = static_cast<uInt>(size);
+
+            // Drain until deflate has consumed all input (and, when finishing, emitted the trailer)
+            for (;;) {
+                stream_.next_out = out_.data();
+                stream_.avail_out = static_cast<uInt>(out_.size());
+
+                int ret = deflate(&stream_, flush);
+                if (ret == Z_STREAM_ERROR) {
+                    throw std::runtime_error("deflate failed");
+                }
+
+                write_file(out_.data(), out_.size() - stream_.avail_out);
+
+                if (flush == Z_FINISH ? ret == Z_STREAM_END : (stream_.avail_in == 0 && stream_.avail_out != 0)) {
+                    break;
+                }
+            }
+        }
+
+        void GzipWriter::write_file(const void* data, size_t size) {
+            if (size == 0) {
+                return;
+            }
+            if (queue_) {
+                queue_->write(queue_file_, data, size);
+            } else if (std::fwrite(data, 1, size, file_) != size) {
+                throw std::runtime_error("gzip write failed");
+            }
+            compressed_ += size;
+        }
+
+        void GzipWriter::begin_parallel_member() {
+            // Same 10-byte header deflate writes for windowBits 31: no name, no mtime, Unix
+            unsigned char header[10] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 3 };
+            header[8] = level_ == 9 ? 2 : (level_ == 1 ? 4 : 0);
+            write_file(header, sizeof(header));
+
+            // The workers are started with the first member and serve every later one
+            if (!pipeline_) {
+                pipeline_ = std::make_unique<BlockPipeline>(threads_, *this);
+            }
+            pending_.clear();
+            dictionary_.clear();
+            dictionary_.reserve(2 * WINDOW_SIZE);  // Room for a short block before trimming
+            member_crc_ = crc32(0L, Z_NULL, 0);
+            member_size_ = 0;
+            member_open_ = true;
+        }
+
+        void GzipWriter::submit_block(bool last) {
+            BlockInput& next = pipeline_->next;
+            next.dictionary.assign(dictionary_.begin(), dictionary_.end());
+            next.level = level_;
+            next.last = last;
+
+            // The next block may refer back into the last 32 KiB of everything before it
+            if (pending_.size() >= WINDOW_SIZE) {
+                dictionary_.assign(pending_.end() - WINDOW_SIZE, pending_.end());
+            } else {
+                dictionary_.insert(dictionary_.end(), pending_.begin(), pending_.end());
+                if (dictionary_.size() > WINDOW_SIZE) {
+                    dictionary_.erase(dictionary_.begin(), dictionary_.end() - WINDOW_SIZE);
+                }
+            }
+
+            // The input handed back by submit() becomes the buffer for the following block
+            next.data.swap(pending_);
+            pipeline_->blocks.submit(next);
+            pending_.swap(next.data);
+            pending_.clear();
+            pending_.reserve(block_size_);
+        }
+
+        void GzipWriter::finish_parallel_member() {
+            // The final block carries the end-of-stream marker, even when it holds no input
+            submit_block(true);
+
+            member_open_ = false;
+            pipeline_->blocks.drain();
+
+            unsigned char trailer[8];
+            put_u32(trailer, static_cast<uint32_t>(member_crc_));
+            put_u32(trailer + 4, static_cast<uint32_t>(member_size_));
+            write_file(trailer, sizeof(trailer));
+        }
+
+    } // namespace writer
+} // namespace rune
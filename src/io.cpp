@@ -0,0 +1,549 @@
+#include "rune/io.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define RUNE_HAVE_IO_URING 1
+#endif
+
+namespace rune {
+    namespace io {
+
+        namespace {
+
+            constexpr size_t PAGE_SIZE = 4096;
+
+            // Batches merged into one pwritev call
+            constexpr size_t MAX_MERGE = 64;
+
+            // Entries in the submission queue
+            constexpr unsigned RING_ENTRIES = 64;
+
+            size_t round_to_page(size_t size) {
+                return std::max(PAGE_SIZE, (size + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE);
+            }
+
+        } // namespace
+
+        // Page-aligned storage for one write
+        struct WriteQueue::Buffer {
+            char* data;
+            size_t capacity;
+            size_t size = 0;
+
+            explicit Buffer(size_t bytes) : data(static_cast<char*>(std::aligned_alloc(PAGE_SIZE, bytes))), capacity(bytes) {
+                if (!data) throw std::bad_alloc();
+            }
+            ~Buffer() { std::free(data); }
+        };
+
+        struct WriteQueue::File {
+            int fd = -1;
+            uint64_t offset = 0;              // Where the next appended byte goes
+            std::unique_ptr<Buffer> pending;  // Batch being filled by write()
+            bool closing = false;
+            bool closed = false;              // Set once the I/O thread has closed the descriptor
+            int error = 0;                    // First failed write or sync (errno), set by the I/O thread
+        };
+
+        struct WriteQueue::Op {
+            enum class Kind { Write, WriteAt, Close };
+
+            Kind kind = Kind::Write;
+            File* file = nullptr;
+            std::unique_ptr<Buffer> buffer;
+            uint64_t offset = 0;
+            size_t done = 0;                  // Bytes of the buffer already written
+        };
+
+#ifdef RUNE_HAVE_IO_URING
+        // The io_uring rings, set up with the raw system calls so no library is needed.
+        // Only the I/O thread touches it.
+        struct WriteQueue::Ring {
+            int fd = -1;
+            void* sq_ring = nullptr;
+            void* cq_ring = nullptr;
+            size_t sq_ring_size = 0;
+            size_t cq_ring_size = 0;
+            io_uring_sqe* sqes = nullptr;
+            size_t sqes_size = 0;
+            unsigned entries = 0;
+
+            unsigned* sq_head = nullptr;
+            unsigned* sq_tail = nullptr;
+            unsigned* sq_mask = nullptr;
+            unsigned* sq_array = nullptr;
+            unsigned* cq_head = nullptr;
+            unsigned* cq_tail = nullptr;
+            unsigned* cq_mask = nullptr;
+            io_uring_cqe* cqes = nullptr;
+
+            ~Ring() {
+                if (sqes) munmap(sqes, sqes_size);
+                if (cq_ring && cq_ring != sq_ring) munmap(cq_ring, cq_ring_size);
+                if (sq_ring) munmap(sq_ring, sq_ring_size);
+                if (fd >= 0) ::close(fd);
+            }
+
+            // Null when the kernel (or a seccomp filter) refuses io_uring or lacks IORING_OP_WRITE
+            static std::unique_ptr<Ring> create(unsigned entries) {
+                io_uring_params params {};
+                const int fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+                if (fd < 0) {
+                    return nullptr;
+                }
+
+                auto ring = std::make_unique<Ring>();
+                ring->fd = fd;
+
+                // IORING_OP_WRITE arrived in Linux 5.6, together with this feature bit
+                if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+                    return nullptr;
+                }
+
+                ring->entries = params.sq_entries;
+                ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+                ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+                const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+                if (single_mmap) {
+                    ring->sq_ring_size = ring->cq_ring_size = std::max(ring->sq_ring_size, ring->cq_ring_size);
+                }
+
+                void* sq = mmap(nullptr, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+                if (sq == MAP_FAILED) {
+                    return nullptr;
+                }
+                ring->sq_ring = sq;
+
+                void* cq = sq;
+                if (!single_mmap) {
+                    cq = mmap(nullptr, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+                    if (cq == MAP_FAILED) {
+                        return nullptr;
+                    }
+                }
+                ring->cq_ring = cq;
+
+                ring->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+                void* sqes = mmap(nullptr, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+                if (sqes == MAP_FAILED) {
+                    return nullptr;
+                }
+                ring->sqes = static_cast<io_uring_sqe*>(sqes);
+
+                char* s = static_cast<char*>(sq);
+                ring->sq_head = reinterpret_cast<unsigned*>(s + params.sq_off.head);
+                ring->sq_tail = reinterpret_cast<unsigned*>(s + params.sq_off.tail);
+                ring->sq_mask = reinterpret_cast<unsigned*>(s + params.sq_off.ring_mask);
+                ring->sq_array = reinterpret_cast<unsigned*>(s + params.sq_off.array);
+
+                char* c = static_cast<char*>(cq);
+                ring->cq_head = reinterpret_cast<unsigned*>(c + params.cq_off.head);
+                ring->cq_tail = reinterpret_cast<unsigned*>(c + params.cq_off.tail);
+                ring->cq_mask = reinterpret_cast<unsigned*>(c + params.cq_off.ring_mask);
+                ring->cqes = reinterpret_cast<io_uring_cqe*>(c + params.cq_off.cqes);
+                return ring;
+            }
+
+            // Queues one write; the caller never queues more than `entries` between submits
+            void push(int file_fd, const void* data, unsigned size, uint64_t offset, uint64_t user_data) {
+                const unsigned tail = *sq_tail;
+                const unsigned index = tail & *sq_mask;
+
+                io_uring_sqe& sqe = sqes[index];
+                std::memset(&sqe, 0, sizeof(sqe));
+                sqe.opcode = IORING_OP_WRITE;
+                sqe.fd = file_fd;
+                sqe.addr = reinterpret_cast<uint64_t>(data);
+                sqe.len = size;
+                sqe.off = offset;
+                sqe.user_data = user_data;
+
+                sq_array[index] = index;
+                __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+            }
+
+            // Submits `count` queued writes with one system call and waits for all of them;
+            // calls on_complete(user_data, result) for each. False if the ring itself failed.
+            template <typename Fn>
+            bool submit_and_wait(unsigned count, Fn&& on_complete) {
+                unsigned to_submit = count;
+                unsigned completed = 0;
+
+                while (completed < count) {
+                    const int ret = static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, 1, IORING_ENTER_GETEVENTS, nullptr, 0));
+                    if (ret < 0) {
+                        if (errno == EINTR || errno == EAGAIN || errno == EBUSY) continue;
+                        return false;
+                    }
+                    to_submit -= std::min<unsigned>(to_submit, static_cast<unsigned>(ret));
+
+                    unsigned head = *cq_head;
+                    const unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+                    for (; head != tail; ++head) {
+                        const io_uring_cqe& cqe = cqes[head & *cq_mask];
+                        on_complete(cqe.user_data, cqe.res);
+                        completed++;
+                    }
+                    __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+                }
+                return true;
+            }
+        };
+#else
+        struct WriteQueue::Ring {
+            unsigned entries = 0;
+
+            static std::unique_ptr<Ring> create(unsigned) { return nullptr; }
+            void push(int, const void*, unsigned, uint64_t, uint64_t) {}
+
+            template <typename Fn>
+            bool submit_and_wait(unsigned, Fn&&) { return false; }
+        };
+#endif
+
+        WriteQueue::WriteQueue() : WriteQueue(Options {}) {}
+
+        WriteQueue::WriteQueue(const Options& options) : options_(options) {
+            options_.batch_bytes = round_to_page(options_.batch_bytes);
+
+            // Sized for a full queue up front, so steady-state writing never grows them
+            const size_t batches = options_.max_queued_bytes / options_.batch_bytes + 64;
+            ops_.reserve(batches);
+            round_.reserve(batches);
+            batch_.reserve(batches);
+            free_.reserve(batches);
+
+            // Buffers for a full queue exist from the start (their pages are only touched
+            // when used), so a disk that falls behind never makes write() allocate
+            queue_buffers_ = options_.max_queued_bytes / options_.batch_bytes + 2;
+            for (size_t i = 0; i < queue_buffers_; ++i) {
+                free_.push_back(std::make_unique<Buffer>(options_.batch_bytes));
+            }
+            if (options_.io_uring) {
+                ring_ = Ring::create(RING_ENTRIES);
+            }
+            uring_ = ring_ != nullptr;
+            thread_ = std::thread([this] { run(); });
+        }
+
+        WriteQueue::~WriteQueue() {
+            for (size_t i = 0; i < files_.size(); ++i) {
+                close(static_cast<int>(i));
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopping_ = true;
+            }
+            work_cv_.notify_one();
+            thread_.join();
+        }
+
+        int WriteQueue::open(const std::string& path, bool truncate) {
+            const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : 0), 0644);
+            if (fd < 0) {
+                return -1;
+            }
+
+            auto file = std::make_unique<File>();
+            file->fd = fd;
+            file->offset = static_cast<uint64_t>(std::max<off_t>(0, ::lseek(fd, 0, SEEK_END)));
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            files_.push_back(std::move(file));
+
+            // Each open file holds one batch being filled
+            open_files_++;
+            if (free_.size() < queue_buffers_ + open_files_) {
+                free_.push_back(std::make_unique<Buffer>(options_.batch_bytes));
+            }
+            return static_cast<int>(files_.size() - 1);
+        }
+
+        void WriteQueue::write(int id, const void* data, size_t size) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            File& file = *files_.at(id);
+            const char* p = static_cast<const char*>(data);
+
+            while (size > 0) {
+                if (!file.pending) {
+                    file.pending = take_buffer();
+                }
+                Buffer& buffer = *file.pending;
+                const size_t take = std::min(size, buffer.capacity - buffer.size);
+                std::memcpy(buffer.data + buffer.size, p, take);
+                buffer.size += take;
+                p += take;
+                size -= take;
+
+                if (buffer.size == buffer.capacity) {
+                    queue_pending(lock, file);
+                }
+            }
+        }
+
+        void WriteQueue::write_at(int id, uint64_t offset, const void* data, size_t size) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            File& file = *files_.at(id);
+            queue_pending(lock, file);
+
+            Op op;
+            op.kind = Op::Kind::WriteAt;
+            op.file = &file;
+            op.buffer = size <= options_.batch_bytes ? take_buffer() : std::make_unique<Buffer>(round_to_page(size));
+            std::memcpy(op.buffer->data, data, size);
+            op.buffer->size = size;
+            op.offset = offset;
+            submit(lock, std::move(op));
+        }
+
+        uint64_t WriteQueue::size(int id) const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const File& file = *files_.at(id);
+            return file.offset + (file.pending ? file.pending->size : 0);
+        }
+
+        bool WriteQueue::close(int id) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            File& file = *files_.at(id);
+            if (!file.closing) {
+                file.closing = true;
+                queue_pending(lock, file);
+
+                Op op;
+                op.kind = Op::Kind::Close;
+                op.file = &file;
+                submit(lock, std::move(op));
+            }
+
+            done_cv_.wait(lock, [&] { return file.closed; });
+            return file.error == 0;
+        }
+
+        const char* WriteQueue::backend() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return uring_ ? "io_uring" : "pwritev";
+        }
+
+        WriteQueue::Stats WriteQueue::stats() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return stats_;
+        }
+
+        std::unique_ptr<WriteQueue::Buffer> WriteQueue::take_buffer() {
+            if (free_.empty()) {
+                return std::make_unique<Buffer>(options_.batch_bytes);
+            }
+            std::unique_ptr<Buffer> buffer = std::move(free_.back());
+            free_.pop_back();
+            buffer->size = 0;
+            return buffer;
+        }
+
+        void WriteQueue::queue_pending(std::unique_lock<std::mutex>& lock, File& file) {
+            if (!file.pending || file.pending->size == 0) {
+                return;
+            }
+
+            Op op;
+            op.kind = Op::Kind::Write;
+            op.file = &file;
+            op.offset = file.offset;
+            file.offset += file.pending->size;
+            op.buffer = std::move(file.pending);
+            submit(lock, std::move(op));
+        }
+
+        void WriteQueue::submit(std::unique_lock<std::mutex>& lock, Op op) {
+            const size_t bytes = op.buffer ? op.buffer->size : 0;
+
+            // The converting thread only waits here, when the disk has fallen behind
+            if (queued_bytes_ > 0 && queued_bytes_ + bytes > options_.max_queued_bytes) {
+                stats_.stalls++;
+                done_cv_.wait(lock, [&] { return queued_bytes_ == 0 || queued_bytes_ + bytes <= options_.max_queued_bytes; });
+            }
+
+            queued_bytes_ += bytes;
+            ops_.push_back(std::move(op));
+            work_cv_.notify_one();
+        }
+
+        void WriteQueue::run() {
+            for (;;) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    work_cv_.wait(lock, [this] { return stopping_ || !ops_.empty(); });
+                    if (ops_.empty()) {
+                        return;
+                    }
+                    round_.clear();
+                    round_.swap(ops_);
+                    stats_.rounds++;
+                }
+
+                // Appends are written together; anything else waits for the appends before it
+                batch_.clear();
+                for (Op& op : round_) {
+                    if (op.kind == Op::Kind::Write) {
+                        batch_.push_back(std::move(op));
+                        continue;
+                    }
+                    write_batch(batch_);
+                    for (Op& written : batch_) finish(written);
+                    batch_.clear();
+
+                    if (op.kind == Op::Kind::WriteAt) {
+                        batch_.push_back(std::move(op));
+                        write_fallback(batch_, 0);
+                        finish(batch_.front());
+                        batch_.clear();
+                    } else {
+                        File& file = *op.file;
+                        if (options_.sync_on_close) {
+                            if (::fsync(file.fd) != 0 && file.error == 0) file.error = errno;
+                            std::lock_guard<std::mutex> lock(mutex_);
+                            stats_.syncs++;
+                        }
+                        if (::close(file.fd) != 0 && file.error == 0) file.error = errno;
+                        file.fd = -1;
+                        finish(op);
+                    }
+                }
+                write_batch(batch_);
+                for (Op& written : batch_) finish(written);
+            }
+        }
+
+        void WriteQueue::write_batch(std::vector<Op>& batch) {
+            size_t first = 0;
+
+            // One system call submits up to a ring's worth of writes and waits for them
+            while (ring_ && first < batch.size()) {
+                const unsigned count = static_cast<unsigned>(std::min<size_t>(batch.size() - first, ring_->entries));
+                for (unsigned i = 0; i < count; ++i) {
+                    Op& op = batch[first + i];
+                    ring_->push(op.file->fd, op.buffer->data, static_cast<unsigned>(op.buffer->size), op.offset, first + i);
+                }
+
+                bool unsupported = false;
+                const bool ok = ring_->submit_and_wait(count, [&](uint64_t index, int result) {
+                    if (result >= 0) {
+                        batch[index].done = static_cast<size_t>(result);
+                    } else if (result == -EINVAL || result == -EOPNOTSUPP) {
+                        unsupported = true;
+                    }
+                });
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    stats_.writes += count;
+                    if (!ok || unsupported) uring_ = false;
+                }
+                if (!ok || unsupported) {
+                    ring_.reset();
+                }
+
+                // Short and failed writes are finished (or their error recorded) synchronously
+                write_fallback(batch, first);
+                first += count;
+            }
+
+            write_fallback(batch, first);
+        }
+
+        void WriteQueue::write_fallback(std::vector<Op>& batch, size_t first) {
+            uint64_t writes = 0;
+
+            for (size_t i = first; i < batch.size();) {
+                Op& head = batch[i];
+                if (head.done == head.buffer->size || head.file->error != 0) {
+                    ++i;
+                    continue;
+                }
+
+                // Batches that continue each other in one file go out in one pwritev
+                size_t end = i + 1;
+                while (end < batch.size() && end - i < MAX_MERGE
+                    && batch[end].file == head.file
+                    && batch[end].done == 0
+                    && batch[end].offset == batch[end - 1].offset + batch[end - 1].buffer->size) {
+                    ++end;
+                }
+
+                iovec iov[MAX_MERGE];
+                int count = 0;
+                for (size_t k = i; k < end; ++k) {
+                    iov[count].iov_base = batch[k].buffer->data + batch[k].done;
+                    iov[count].iov_len = batch[k].buffer->size - batch[k].done;
+                    ++count;
+                }
+
+                uint64_t offset = head.offset + head.done;
+                int next = 0;
+                while (next < count) {
+                    const ssize_t n = ::pwritev(head.file->fd, iov + next, count - next, static_cast<off_t>(offset));
+                    writes++;
+                    if (n < 0) {
+                        if (errno == EINTR) continue;
+                        head.file->error = errno;
+                        break;
+                    }
+                    if (n == 0) {
+                        head.file->error = EIO;
+                        break;
+                    }
+                    offset += static_cast<uint64_t>(n);
+
+                    size_t left = static_cast<size_t>(n);
+                    while (next < count && left >= iov[next].iov_len) {
+                        left -= iov[next].iov_len;
+                        ++next;
+                    }
+                    if (next < count) {
+                        iov[next].iov_base = static_cast<char*>(iov[next].iov_base) + left;
+                        iov[next].iov_len -= left;
+                    }
+                }
+
+                if (head.file->error == 0) {
+                    for (size_t k = i; k < end; ++k) batch[k].done = batch[k].buffer->size;
+                }
+                i = end;
+            }
+
+            if (writes > 0) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stats_.writes += writes;
+            }
+        }
+
+        void WriteQueue::finish(Op& op) {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            if (op.buffer) {
+                stats_.bytes += op.done;
+                queued_bytes_ -= op.buffer->size;
+                if (op.buffer->capacity == options_.batch_bytes && free_.size() < queue_buffers_ + open_files_) {
+                    free_.push_back(std::move(op.buffer));
+                }
+            }
+            if (op.kind == Op::Kind::Close) {
+                op.file->closed = true;
+                open_files_--;
+            }
+            done_cv_.notify_all();
+        }
+
+    } // namespace io
+} // namespace rune
@@ -0,0 +1,242 @@
+#include "rune/jsonl.hpp"
+
+#include <charconv>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace rune {
+    namespace jsonl {
+
+        namespace {
+
+            [[noreturn]] void malformed() {
+                throw std::runtime_error("malformed frames.jsonl line");
+            }
+
+            void expect(std::string_view& p, std::string_view literal) {
+                if (p.substr(0, literal.size()) != literal) malformed();
+                p.remove_prefix(literal.size());
+            }
+
+            unsigned parse_uint(std::string_view& p) {
+                unsigned value = 0;
+                auto [end, ec] = std::from_chars(p.data(), p.data() + p.size(), value);
+                if (ec != std::errc()) malformed();
+                p.remove_prefix(static_cast<size_t>(end - p.data()));
+                return value;
+            }
+
+            unsigned parse_hex4(std::string_view& p) {
+                if (p.size() < 4) malformed();
+                unsigned value = 0;
+                auto [end, ec] = std::from_chars(p.data(), p.data() + 4, value, 16);
+                if (ec != std::errc() || end != p.data() + 4) malformed();
+                p.remove_prefix(4);
+                return value;
+            }
+
+            void append_utf8(std::string& out, uint32_t cp) {
+                if (cp < 0x80) {
+                    out += static_cast<char>(cp);
+                } else if (cp < 0x800) {
+                    out += static_cast<char>(0xC0 | (cp >> 6));
+                    out += static_cast<char>(0x80 | (cp & 0x3F));
+                } else if (cp < 0x10000) {
+                    out += static_cast<char>(0xE0 | (cp >> 12));
+                    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                    out += static_cast<char>(0x80 | (cp & 0x3F));
+                } else {
+                    out += static_cast<char>(0xF0 | (cp >> 18));
+                    out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+                    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                    out += static_cast<char>(0x80 | (cp & 0x3F));
+                }
+            }
+
+            // Parses a JSON string body (after the opening quote) up to and including the closing quote
+            void parse_string(std::string_view& p, std::string& out) {
+                out.clear();
+                for (;;) {
+                    if (p.empty()) malformed();
+                    char c = p.front();
+                    p.remove_prefix(1);
+
+                    if (c == '"') return;
+                    if (c != '\\') {
+                        out += c;
+                        continue;
+                    }
+
+                    if (p.empty()) malformed();
+                    char e = p.front();
+                    p.remove_prefix(1);
+                    switch (e) {
+                        case '"': out += '"'; break;
+                        case '\\': out += '\\'; break;
+                        case '/': out += '/'; break;
+                        case 'b': out += '\b'; break;
+                        case 'f': out += '\f'; break;
+                        case 'n': out += '\n'; break;
+                        case 'r': out += '\r'; break;
+                        case 't': out += '\t'; break;
+                        case 'u': {
+                            uint32_t cp = parse_hex4(p);
+                            // Surrogate pair for code points above the BMP
+                            if (cp >= 0xD800 && cp < 0xDC00 && p.substr(0, 2) == "\\u") {
+                                p.remove_prefix(2);
+                                cp = 0x10000 + ((cp - 0xD800) << 10) + (parse_hex4(p) - 0xDC00);
+                            }
+                            append_utf8(out, cp);
+                            break;
+                        }
+                        default: malformed();
+                    }
+                }
+            }
+
+        } // namespace
+
+        FrameReader::FrameReader(std::istream& in, int cols) : in_(in), cols_(cols) {
+            if (cols_ <= 0) {
+                throw std::runtime_error("frame reader needs a positive column count");
+            }
+        }
+
+        uint8_t FrameReader::intern(const std::string& glyph, CellBuffer& cells) {
+            auto it = glyph_index_.find(glyph);
+            if (it != glyph_index_.end()) {
+                return it->second;
+            }
+            if (cells.glyph_table.size() >= 256) {
+                throw std::runtime_error("too many distinct glyphs in frames.jsonl");
+            }
+
+            uint8_t index = static_cast<uint8_t>(cells.glyph_table.size());
+            cells.glyph_table.push_back(glyph);
+            glyph_index_.emplace(glyph, index);
+            return index;
+        }
+
+        void FrameReader::parse_cells(std::string_view& p, CellBuffer& cells, size_t first, bool append) {
+            // p is positioned right after "cells":[
+            size_t i = first;
+            if (!p.empty() && p.front() == ']') {
+                p.remove_prefix(1);
+                return;
+            }
+
+            for (;;) {
+                expect(p, R"({"g":")");
+                parse_string(p, glyph_);
+                const uint8_t glyph = intern(glyph_, cells);
+                expect(p, R"(,"h":)");
+                const unsigned h = parse_uint(p);
+                expect(p, R"(,"s":)");
+                const unsigned s = parse_uint(p);
+                expect(p, R"(,"l":)");
+                const unsigned l = parse_uint(p);
+                expect(p, "}");
+
+                if (append) {
+                    cells.glyphs.push_back(glyph);
+                    cells.h.push_back(static_cast<uint16_t>(h));
+                    cells.s.push_back(static_cast<uint8_t>(s));
+                    cells.l.push_back(static_cast<uint8_t>(l));
+                } else {
+                    if (i >= cells.size()) malformed();
+                    cells.glyphs[i] = glyph;
+                    cells.h[i] = static_cast<uint16_t>(h);
+                    cells.s[i] = static_cast<uint8_t>(s);
+                    cells.l[i] = static_cast<uint8_t>(l);
+                }
+                ++i;
+
+                if (p.empty()) malformed();
+                const char c = p.front();
+                p.remove_prefix(1);
+                if (c == ']') return;
+                if (c != ',') malformed();
+            }
+        }
+
+        bool FrameReader::next(CellBuffer& cells) {
+            do {
+                if (!std::getline(in_, line_)) {
+                    return false;
+                }
+            } while (line_.empty());
+
+            // The glyph table is owned by the reader across frames
+            if (!have_frame_) {
+                cells.glyph_table.clear();
+                glyph_index_.clear();
+            }
+
+            std::string_view p = line_;
+
+            if (p.substr(0, 10) == R"({"cells":[)") {
+                p.remove_prefix(10);
+                cells.glyphs.clear();
+                cells.h.clear();
+                cells.s.clear();
+                cells.l.clear();
+                parse_cells(p, cells, 0, true);
+                expect(p, "}");
+
+                cells.cols = cols_;
+                cells.rows = static_cast<int>(cells.size() / cols_);
+                have_frame_ = true;
+                return true;
+            }
+
+            expect(p, R"({"d":[)");
+            if (!have_frame_) {
+                throw std::runtime_error("delta frame before the first keyframe");
+            }
+
+            if (!p.empty() && p.front() == ']') {
+                p.remove_prefix(1);
+            } else {
+                for (;;) {
+                    expect(p, R"({"i":)");
+                    const size_t first = parse_uint(p);
+                    expect(p, R"(,"cells":[)");
+                    parse_cells(p, cells, first, false);
+                    expect(p, "}");
+
+                    if (p.empty()) malformed();
+                    const char c = p.front();
+                    p.remove_prefix(1);
+                    if (c == ']') break;
+                    if (c != ',') malformed();
+                }
+            }
+            expect(p, "}");
+            return true;
+        }
+
+        void read_manifest(const std::string& path, int& cols, int& fps) {
+            std::ifstream in(path);
+            if (!in) {
+                return;
+            }
+
+            std::stringstream ss;
+            ss << in.rdbuf();
+            const std::string text = ss.str();
+
+            auto field = [&](const char* key, int& value) {
+                size_t pos = text.find(key);
+                if (pos == std::string::npos) return;
+                pos = text.find(':', pos);
+                if (pos == std::string::npos) return;
+                value = std::stoi(text.substr(pos + 1));
+            };
+
+            field("\"cols\"", cols);
+            field("\"fps\"", fps);
+        }
+
+    } // namespace jsonl
+} // namespace rune
@@ -0,0 +1,239 @@
+#include "rune/kernel.hpp"
+#include "rune/converter.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define RUNE_KERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+namespace rune {
+    namespace kernel {
+
+        namespace {
+
+            // Reference path: one rgb_to_hsl call per pixel, same math as the SIMD lanes
+            void map_row_scalar(const uint8_t* pixels, int count, int stride, float threshold, int last_glyph,
+                                uint8_t* glyphs, uint16_t* h, uint8_t* s, uint8_t* l) {
+                for (int x = 0; x < count; ++x) {
+                    const uint8_t* px = pixels + static_cast<size_t>(x) * stride;
+                    converter::HSL hsl = converter::rgb_to_hsl(px[0], px[1], px[2]);
+
+                    float adjusted_l = (hsl.l > threshold) ? 1.0f : hsl.l;
+                    float t = std::clamp(adjusted_l, 0.0f, 1.0f);
+
+                    glyphs[x] = static_cast<uint8_t>(std::round(t * last_glyph));
+                    h[x] = static_cast<uint16_t>(hsl.h);
+                    s[x] = static_cast<uint8_t>(hsl.s * 100.0f);
+                    l[x] = static_cast<uint8_t>(adjusted_l * 100.0f);
+                }
+            }
+
+#if RUNE_KERNEL_X86
+            // The vector paths evaluate exactly the operations of rgb_to_hsl in the same
+            // order (divides included, no FMA), with the branches turned into blends:
+            //   - fmod(x, 6) is the identity because (g - b) / delta lies in [-1, 1]
+            //   - std::round on t >= 0 is trunc(x) + (frac(x) >= 0.5)
+            // so results agree with the scalar path lane for lane.
+
+            __attribute__((target("sse4.1")))
+            void map_row_sse41(const uint8_t* pixels, int count, int stride, float threshold, int last_glyph,
+                               uint8_t* glyphs, uint16_t* h, uint8_t* s, uint8_t* l) {
+                const __m128 v255 = _mm_set1_ps(255.0f);
+                const __m128 zero = _mm_setzero_ps();
+                const __m128 one = _mm_set1_ps(1.0f);
+                const __m128 half = _mm_set1_ps(0.5f);
+                const __m128 two = _mm_set1_ps(2.0f);
+                const __m128 four = _mm_set1_ps(4.0f);
+                const __m128 sixty = _mm_set1_ps(60.0f);
+                const __m128 full_turn = _mm_set1_ps(360.0f);
+                const __m128 hundred = _mm_set1_ps(100.0f);
+                const __m128 wr = _mm_set1_ps(0.2126f);
+                const __m128 wg = _mm_set1_ps(0.7152f);
+                const __m128 wb = _mm_set1_ps(0.0722f);
+                const __m128 thr = _mm_set1_ps(threshold);
+                const __m128 steps = _mm_set1_ps(static_cast<float>(last_glyph));
+
+                alignas(16) float rs[4], gs[4], bs[4];
+                alignas(16) int32_t out_g[4], out_h[4], out_s[4], out_l[4];
+
+                int x = 0;
+                for (; x + 4 <= count; x += 4) {
+                    for (int k = 0; k < 4; ++k) {
+                        const uint8_t* px = pixels + static_cast<size_t>(x + k) * stride;
+                        rs[k] = px[0];
+                        gs[k] = px[1];
+                        bs[k] = px[2];
+                    }
+
+                    __m128 rf = _mm_div_ps(_mm_load_ps(rs), v255);
+                    __m128 gf = _mm_div_ps(_mm_load_ps(gs), v255);
+                    __m128 bf = _mm_div_ps(_mm_load_ps(bs), v255);
+
+                    __m128 lum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(wr, rf), _mm_mul_ps(wg, gf)), _mm_mul_ps(wb, bf));
+
+                    __m128 maxc = _mm_max_ps(_mm_max_ps(rf, gf), bf);
+                    __m128 minc = _mm_min_ps(_mm_min_ps(rf, gf), bf);
+                    __m128 delta = _mm_sub_ps(maxc, minc);
+
+                    __m128 hr = _mm_mul_ps(sixty, _mm_div_ps(_mm_sub_ps(gf, bf), delta));
+                    __m128 hg = _mm_mul_ps(sixty, _mm_add_ps(_mm_div_ps(_mm_sub_ps(bf, rf), delta), two));
+                    __m128 hb = _mm_mul_ps(sixty, _mm_add_ps(_mm_div_ps(_mm_sub_ps(rf, gf), delta), four));
+
+                    __m128 hue = _mm_blendv_ps(hb, hg, _mm_cmpeq_ps(maxc, gf));
+                    hue = _mm_blendv_ps(hue, hr, _mm_cmpeq_ps(maxc, rf));
+                    hue = _mm_add_ps(hue, _mm_and_ps(_mm_cmplt_ps(hue, zero), full_turn));
+                    hue = _mm_and_ps(hue, _mm_cmpneq_ps(delta, zero));
+
+                    __m128 sat = _mm_and_ps(_mm_div_ps(delta, maxc), _mm_cmpneq_ps(maxc, zero));
+
+                    __m128 adj = _mm_blendv_ps(lum, one, _mm_cmpgt_ps(lum, thr));
+                    __m128 t = _mm_mul_ps(_mm_min_ps(_mm_max_ps(adj, zero), one), steps);
+                    __m128 whole = _mm_round_ps(t, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+                    __m128 rounded = _mm_add_ps(whole, _mm_and_ps(_mm_cmpge_ps(_mm_sub_ps(t, whole), half), one));
+
+                    _mm_store_si128(reinterpret_cast<__m128i*>(out_g), _mm_cvttps_epi32(rounded));
+                    _mm_store_si128(reinterpret_cast<__m128i*>(out_h), _mm_cvttps_epi32(hue));
+                    _mm_store_si128(reinterpret_cast<__m128i*>(out_s), _mm_cvttps_epi32(_mm_mul_ps(sat, hundred)));
+                    _mm_store_si128(reinterpret_cast<__m128i*>(out_l), _mm_cvttps_epi32(_mm_mul_ps(adj, hundred)));
+
+                    for (int k = 0; k < 4; ++k) {
+                        glyphs[x + k] = static_cast<uint8_t>(out_g[k]);
+                        h[x + k] = static_cast<uint16_t>(out_h[k]);
+                        s[x + k] = static_cast<uint8_t>(out_s[k]);
+                        l[x + k] = static_cast<uint8_t>(out_l[k]);
+                    }
+                }
+
+                map_row_scalar(pixels + static_cast<size_t>(x) * stride, count - x, stride, threshold, last_glyph,
+                               glyphs + x, h + x, s + x, l + x);
+            }
+
+            __attribute__((target("avx2")))
+            void map_row_avx2(const uint8_t* pixels, int count, int stride, float threshold, int last_glyph,
+                              uint8_t* glyphs, uint16_t* h, uint8_t* s, uint8_t* l) {
+                const __m256 v255 = _mm256_set1_ps(255.0f);
+                const __m256 zero = _mm256_setzero_ps();
+                const __m256 one = _mm256_set1_ps(1.0f);
+                const __m256 half = _mm256_set1_ps(0.5f);
+                const __m256 two = _mm256_set1_ps(2.0f);
+                const __m256 four = _mm256_set1_ps(4.0f);
+                const __m256 sixty = _mm256_set1_ps(60.0f);
+                const __m256 full_turn = _mm256_set1_ps(360.0f);
+                const __m256 hundred = _mm256_set1_ps(100.0f);
+                const __m256 wr = _mm256_set1_ps(0.2126f);
+                const __m256 wg = _mm256_set1_ps(0.7152f);
+                const __m256 wb = _mm256_set1_ps(0.0722f);
+                const __m256 thr = _mm256_set1_ps(threshold);
+                const __m256 steps = _mm256_set1_ps(static_cast<float>(last_glyph));
+
+                alignas(32) float rs[8], gs[8], bs[8];
+                alignas(32) int32_t out_g[8], out_h[8], out_s[8], out_l[8];
+
+                int x = 0;
+                for (; x + 8 <= count; x += 8) {
+                    for (int k = 0; k < 8; ++k) {
+                        const uint8_t* px = pixels + static_cast<size_t>(x + k) * stride;
+                        rs[k] = px[0];
+                        gs[k] = px[1];
+                        bs[k] = px[2];
+                    }
+
+                    __m256 rf = _mm256_div_ps(_mm256_load_ps(rs), v255);
+                    __m256 gf = _mm256_div_ps(_mm256_load_ps(gs), v255);
+                    __m256 bf = _mm256_div_ps(_mm256_load_ps(bs), v255);
+
+                    __m256 lum = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(wr, rf), _mm256_mul_ps(wg, gf)), _mm256_mul_ps(wb, bf));
+
+                    __m256 maxc = _mm256_max_ps(_mm256_max_ps(rf, gf), bf);
+                    __m256 minc = _mm256_min_ps(_mm256_min_ps(rf, gf), bf);
+                    __m256 delta = _mm256_sub_ps(maxc, minc);
+
+                    __m256 hr = _mm256_mul_ps(sixty, _mm256_div_ps(_mm256_sub_ps(gf, bf), delta));
+                    __m256 hg = _mm256_mul_ps(sixty, _mm256_add_ps(_mm256_div_ps(_mm256_sub_ps(bf, rf), delta), two));
+                    __m256 hb = _mm256_mul_ps(sixty, _mm256_add_ps(_mm256_div_ps(_mm256_sub_ps(rf, gf), delta), four));
+
+                    __m256 hue = _mm256_blendv_ps(hb, hg, _mm256_cmp_ps(maxc, gf, _CMP_EQ_OQ));
+                    hue = _mm256_blendv_ps(hue, hr, _mm256_cmp_ps(maxc, rf, _CMP_EQ_OQ));
+                    hue = _mm256_add_ps(hue, _mm256_and_ps(_mm256_cmp_ps(hue, zero, _CMP_LT_OQ), full_turn));
+                    hue = _mm256_and_ps(hue, _mm256_cmp_ps(delta, zero, _CMP_NEQ_UQ));
+
+                    __m256 sat = _mm256_and_ps(_mm256_div_ps(delta, maxc), _mm256_cmp_ps(maxc, zero, _CMP_NEQ_UQ));
+
+                    __m256 adj = _mm256_blendv_ps(lum, one, _mm256_cmp_ps(lum, thr, _CMP_GT_OQ));
+                    __m256 t = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(adj, zero), one), steps);
+                    __m256 whole = _mm256_round_ps(t, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+                    __m256 rounded = _mm256_add_ps(whole, _mm256_and_ps(_mm256_cmp_ps(_mm256_sub_ps(t, whole), half, _CMP_GE_OQ), one));
+
+                    _mm256_store_si256(reinterpret_cast<__m256i*>(out_g), _mm256_cvttps_epi32(rounded));
+                    _mm256_store_si256(reinterpret_cast<__m256i*>(out_h), _mm256_cvttps_epi32(hue));
+                    _mm256_store_si256(reinterpret_cast<__m256i*>(out_s), _mm256_cvttps_epi32(_mm256_mul_ps(sat, hundred)));
+                    _mm256_store_si256(reinterpret_cast<__m256i*>(out_l), _mm256_cvttps_epi32(_mm256_mul_ps(adj, hundred)));
+
+                    for (int k = 0; k < 8; ++k) {
+                        glyphs[x + k] = static_cast<uint8_t>(out_g[k]);
+                        h[x + k] = static_cast<uint16_t>(out_h[k]);
+                        s[x + k] = static_cast<uint8_t>(out_s[k]);
+                        l[x + k] = static_cast<uint8_t>(out_l[k]);
+                    }
+                }
+
+                map_row_scalar(pixels + static_cast<size_t>(x) * stride, count - x, stride, threshold, last_glyph,
+                               glyphs + x, h + x, s + x, l + x);
+            }
+#endif
+
+            bool supports(Isa isa) {
+#if RUNE_KERNEL_X86
+                switch (isa) {
+                    case Isa::AVX2:  return __builtin_cpu_supports("avx2");
+                    case Isa::SSE41: return __builtin_cpu_supports("sse4.1");
+                    case Isa::Scalar: return true;
+                }
+                return false;
+#else
+                return isa == Isa::Scalar;
+#endif
+            }
+
+        } // namespace
+
+        Isa detect_isa() {
+            static const Isa best = [] {
+                if (supports(Isa::AVX2)) return Isa::AVX2;
+                if (supports(Isa::SSE41)) return Isa::SSE41;
+                return Isa::Scalar;
+            }();
+            return best;
+        }
+
+        const char* isa_name(Isa isa) {
+            switch (isa) {
+                case Isa::AVX2:  return "avx2";
+                case Isa::SSE41: return "sse4.1";
+                case Isa::Scalar: return "scalar";
+            }
+            return "unknown";
+        }
+
+        void map_row(const uint8_t* pixels, int count, int stride, float threshold, int last_glyph,
+                     uint8_t* glyphs, uint16_t* h, uint8_t* s, uint8_t* l) {
+            map_row(detect_isa(), pixels, count, stride, threshold, last_glyph, glyphs, h, s, l);
+        }
+
+        void map_row(Isa isa, const uint8_t* pixels, int count, int stride, float threshold, int last_glyph,
+                     uint8_t* glyphs, uint16_t* h, uint8_t* s, uint8_t* l) {
+#if RUNE_KERNEL_X86
+            if (isa == Isa::AVX2 && supports(Isa::AVX2)) {
+                map_row_avx2(pixels, count, stride, threshold, last_glyph, glyphs, h, s, l);
+                return;
+            }
+            if (isa != Isa::Scalar && supports(Isa::SSE41)) {
+                map_row_sse41(pixels, count, stride, threshold, last_glyph, glyphs, h, s, l);
+                return;
+            }
+#endif
+            map_row_scalar(pixels, count, stride, threshold, last_glyph, glyphs, h, s, l);
+        }
+
+    } // namespace kernel
+} // namespace rune
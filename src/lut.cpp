@@ -0,0 +1,143 @@
+#include "rune/lut.hpp"
+#include "rune/kernel.hpp"
+
+#include <bit>
+#include <future>
+#include <list>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+
+namespace rune {
+    namespace lut {
+
+        namespace {
+
+            // Tables kept by get_lut for reuse: two 8-bit tables, or dozens at 6 bits
+            constexpr size_t MAX_CACHED_BYTES = 256u << 20;
+
+        } // namespace
+
+        ColorLut::ColorLut(int bits, float threshold, int last_glyph) : bits_(bits) {
+            if (bits < 1 || bits > 8) {
+                throw std::invalid_argument("lut bits must be in [1, 8]");
+            }
+
+            const int levels = 1 << bits;
+            const int shift = 8 - bits;
+
+            entries_.resize(static_cast<size_t>(levels) * levels * levels);
+
+            // Bucket centres for one channel
+            std::vector<uint8_t> centre(levels);
+            for (int i = 0; i < levels; ++i) {
+                centre[i] = static_cast<uint8_t>((i << shift) + ((1 << shift) >> 1));
+            }
+
+            // Each (r, g) pair is one row of `levels` pixels through the row kernel
+            std::vector<uint8_t> row_pixels(static_cast<size_t>(levels) * 3);
+            std::vector<uint8_t> glyphs(levels), s(levels), l(levels);
+            std::vector<uint16_t> h(levels);
+
+            for (int r = 0; r < levels; ++r) {
+                for (int g = 0; g < levels; ++g) {
+                    for (int b = 0; b < levels; ++b) {
+                        row_pixels[b * 3] = centre[r];
+                        row_pixels[b * 3 + 1] = centre[g];
+                        row_pixels[b * 3 + 2] = centre[b];
+                    }
+
+                    kernel::map_row(row_pixels.data(), levels, 3, threshold, last_glyph,
+                                    glyphs.data(), h.data(), s.data(), l.data());
+
+                    LutEntry* out = entries_.data() + ((static_cast<size_t>(r) << (2 * bits)) | (static_cast<size_t>(g) << bits));
+                    for (int b = 0; b < levels; ++b) {
+                        out[b] = LutEntry { h[b], glyphs[b], s[b], l[b] };
+                    }
+                }
+            }
+        }
+
+        void ColorLut::map_row(const uint8_t* pixels, int count, int stride,
+                               uint8_t* glyphs, uint16_t* h, uint8_t* s, uint8_t* l) const {
+            for (int x = 0; x < count; ++x) {
+                const uint8_t* px = pixels + static_cast<size_t>(x) * stride;
+                const LutEntry& entry = lookup(px[0], px[1], px[2]);
+                glyphs[x] = entry.glyph;
+                h[x] = entry.h;
+                s[x] = entry.s;
+                l[x] = entry.l;
+            }
+        }
+
+        std::shared_ptr<const ColorLut> get_lut(int glyph_count, float threshold, int bits) {
+            if (bits < 1 || bits > 8) {
+                throw std::invalid_argument("lut bits must be in [1, 8]");
+            }
+
+            // Keyed on the exact threshold bits so equal settings always share a table
+            using Key = std::tuple<int, uint32_t, int>;
+            using Table = std::shared_future<std::shared_ptr<const ColorLut>>;
+
+            struct Entry {
+                Key key;
+                Table table;
+                size_t bytes;
+            };
+
+            static std::mutex mutex;
+            static std::list<Entry> recent;  // Most recently used first
+            static std::map<Key, std::list<Entry>::iterator> index;
+            static size_t cached_bytes = 0;
+
+            const Key key { glyph_count, std::bit_cast<uint32_t>(threshold), bits };
+
+            std::promise<std::shared_ptr<const ColorLut>> built;
+            Table table;
+            bool build = false;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto it = index.find(key);
+                if (it != index.end()) {
+                    recent.splice(recent.begin(), recent, it->second);
+                    table = it->second->table;
+                } else {
+                    table = built.get_future().share();
+                    build = true;
+                    const size_t bytes = (static_cast<size_t>(1) << (3 * bits)) * sizeof(LutEntry);
+                    recent.push_front(Entry { key, table, bytes });
+                    index.emplace(key, recent.begin());
+                    cached_bytes += bytes;
+
+                    // Dropping an entry only unshares it: jobs holding the table keep it
+                    while (cached_bytes > MAX_CACHED_BYTES && recent.size() > 1) {
+                        cached_bytes -= recent.back().bytes;
+                        index.erase(recent.back().key);
+                        recent.pop_back();
+                    }
+                }
+            }
+
+            // The table is built outside the lock; callers asking for the same
+            // settings meanwhile wait on the future rather than building it twice
+            if (build) {
+                try {
+                    built.set_value(std::make_shared<const ColorLut>(bits, threshold, glyph_count - 1));
+                } catch (...) {
+                    built.set_exception(std::current_exception());
+
+                    std::lock_guard<std::mutex> lock(mutex);
+                    auto it = index.find(key);
+                    if (it != index.end()) {
+                        cached_bytes -= it->second->bytes;
+                        recent.erase(it->second);
+                        index.erase(it);
+                    }
+                }
+            }
+            return table.get();
+        }
+
+    } // namespace lut
+} // namespace rune
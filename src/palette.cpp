@@ -0,0 +1,65 @@
+#include "rune/palette.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace rune {
+    namespace palette {
+
+        namespace {
+
+            std::string base36(int value) {
+                static const char digits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+                std::string out;
+                do {
+                    out.insert(out.begin(), digits[value % 36]);
+                    value /= 36;
+                } while (value > 0);
+                return out;
+            }
+
+            std::string hsl(int h, int s, int l) {
+                return "hsl(" + std::to_string(h) + "," + std::to_string(s) + "%," + std::to_string(l) + "%)";
+            }
+
+        } // namespace
+
+        Palette::Palette(int size) {
+            size = std::max(size, 4);
+
+            // Lightness carries the image, so it gets the most steps; the greys take
+            // one row of the grid and hue fills whatever budget is left
+            const double root = std::cbrt(static_cast<double>(size));
+            lightness_levels_ = std::max(2, static_cast<int>(std::lround(root * 1.2)));
+            saturation_levels_ = std::max(2, static_cast<int>(std::lround(root / 1.6)));
+            hue_levels_ = std::max(1, (size - lightness_levels_) / (lightness_levels_ * (saturation_levels_ - 1)));
+
+            auto level = [](int q, int levels) { return q * 100 / (levels - 1); };
+
+            for (int lq = 0; lq < lightness_levels_; ++lq) {
+                colours_.push_back(hsl(0, 0, level(lq, lightness_levels_)));
+            }
+            for (int hq = 0; hq < hue_levels_; ++hq) {
+                for (int sq = 1; sq < saturation_levels_; ++sq) {
+                    for (int lq = 0; lq < lightness_levels_; ++lq) {
+                        colours_.push_back(hsl(hq * 360 / hue_levels_, level(sq, saturation_levels_), level(lq, lightness_levels_)));
+                    }
+                }
+            }
+
+            for (size_t i = 0; i < colours_.size(); ++i) {
+                std::string name = "p";
+                name += base36(static_cast<int>(i));
+                classes_.push_back(std::move(name));
+            }
+        }
+
+        void Palette::write_stylesheet(std::ostream& out) const {
+            for (size_t i = 0; i < classes_.size(); ++i) {
+                out << "." << classes_[i] << "{color:" << colours_[i] << "}\n";
+            }
+        }
+
+    } // namespace palette
+} // namespace rune
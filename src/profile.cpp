@@ -0,0 +1,201 @@
+#include "rune/profile.hpp"
+
+#include <algorithm>
+#include <ctime>
+#include <filesystem>
+#include <iomanip>
+#include <map>
+#include <sys/resource.h>
+
+namespace rune {
+    namespace profile {
+
+        namespace {
+
+            std::atomic<Profiler*> active { nullptr };
+
+            uint64_t wall_now_ns() {
+                return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count());
+            }
+
+            // CPU time of the calling thread; a vDSO call on Linux
+            uint64_t cpu_now_ns() {
+                timespec ts {};
+                clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+                return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+            }
+
+            // Nearest-rank percentile of sorted samples
+            double percentile(const std::vector<double>& sorted, double p) {
+                if (sorted.empty()) return 0.0;
+                size_t rank = static_cast<size_t>(p / 100.0 * static_cast<double>(sorted.size()) + 0.999999);
+                rank = std::clamp<size_t>(rank, 1, sorted.size());
+                return sorted[rank - 1];
+            }
+
+            // Output format of a file, keyed like the report's "bytes" object
+            std::string format_of(const std::filesystem::path& path) {
+                const std::string name = path.filename().string();
+                auto ends_with = [&](const std::string& suffix) {
+                    return name.size() >= suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+                };
+
+                if (ends_with(".jsonl.gz.index.json")) return "seek_index";
+                if (ends_with(".jsonl.gz")) return "jsonl_gz";
+                if (ends_with(".jsonl")) return "jsonl";
+                if (ends_with(".txt")) return "html";
+                if (ends_with(".runeb")) return "runeb";
+                if (ends_with(".json")) return "json";
+                return "other";
+            }
+
+        } // namespace
+
+        const char* stage_name(Stage stage) {
+            switch (stage) {
+                case Stage::Input: return "input";
+                case Stage::Decode: return "decode";
+                case Stage::Cache: return "cache";
+                case Stage::Resize: return "resize";
+                case Stage::Cells: return "cells";
+                case Stage::Html: return "html";
+                case Stage::Serialize: return "serialize";
+                case Stage::WriteJsonl: return "write_jsonl";
+                case Stage::WriteGzip: return "write_gzip";
+                case Stage::WriteHtml: return "write_html";
+                case Stage::WriteRuneb: return "write_runeb";
+                case Stage::Count: break;
+            }
+            return "unknown";
+        }
+
+        Profiler::Profiler() {
+            start();
+            stopped_ = started_;
+        }
+
+        void Profiler::start() {
+            started_ = std::chrono::steady_clock::now();
+        }
+
+        void Profiler::stop() {
+            stopped_ = std::chrono::steady_clock::now();
+        }
+
+        void Profiler::add(Stage stage, uint64_t wall_ns, uint64_t cpu_ns) {
+            Totals& totals = stages_[static_cast<size_t>(stage)];
+            totals.wall_ns.fetch_add(wall_ns, std::memory_order_relaxed);
+            totals.cpu_ns.fetch_add(cpu_ns, std::memory_order_relaxed);
+            totals.calls.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void Profiler::frame_done(double latency_ms) {
+            std::lock_guard<std::mutex> lock(latency_mutex_);
+            latencies_ms_.push_back(latency_ms);
+        }
+
+        void Profiler::print_stages(std::ostream& out) const {
+            out << std::fixed << std::setprecision(2);
+            out << "stage            wall ms      cpu ms     calls\n";
+            for (size_t i = 0; i < stages_.size(); ++i) {
+                const uint64_t calls = stages_[i].calls.load();
+                if (calls == 0) continue;
+
+                out << std::left << std::setw(12) << stage_name(static_cast<Stage>(i)) << std::right
+                    << std::setw(12) << stages_[i].wall_ns.load() / 1e6
+                    << std::setw(12) << stages_[i].cpu_ns.load() / 1e6
+                    << std::setw(10) << calls << "\n";
+            }
+        }
+
+        void Profiler::write_report(std::ostream& out, const std::string& output_folder) const {
+            std::vector<double> sorted;
+            {
+                std::lock_guard<std::mutex> lock(latency_mutex_);
+                sorted = latencies_ms_;
+            }
+            std::sort(sorted.begin(), sorted.end());
+
+            const double wall_s = std::chrono::duration<double>(stopped_ - started_).count();
+            const size_t frames = sorted.size();
+
+            std::map<std::string, uintmax_t> bytes;
+            std::error_code ec;
+            if (std::filesystem::is_directory(output_folder, ec)) {
+                for (auto& entry : std::filesystem::recursive_directory_iterator(output_folder, ec)) {
+                    if (entry.is_regular_file()) {
+                        bytes[format_of(entry.path())] += entry.file_size();
+                    }
+                }
+            }
+
+            out << std::fixed << std::setprecision(3);
+            out << "{\n";
+            out << "  \"frames\": " << frames << ",\n";
+            out << "  \"wall_s\": " << wall_s << ",\n";
+            out << "  \"fps\": " << (wall_s > 0.0 ? frames / wall_s : 0.0) << ",\n";
+            out << "  \"latency_ms\": {"
+                << "\"p50\":" << percentile(sorted, 50) << ","
+                << "\"p90\":" << percentile(sorted, 90) << ","
+                << "\"p99\":" << percentile(sorted, 99) << ","
+                << "\"max\":" << (sorted.empty() ? 0.0 : sorted.back()) << "},\n";
+
+            out << "  \"stages\": {";
+            bool first = true;
+            for (size_t i = 0; i < stages_.size(); ++i) {
+                const uint64_t calls = stages_[i].calls.load();
+                if (calls == 0) continue;
+
+                out << (first ? "" : ",") << "\n    \"" << stage_name(static_cast<Stage>(i)) << "\": {"
+                    << "\"wall_ms\":" << stages_[i].wall_ns.load() / 1e6 << ","
+                    << "\"cpu_ms\":" << stages_[i].cpu_ns.load() / 1e6 << ","
+                    << "\"calls\":" << calls << "}";
+                first = false;
+            }
+            out << (first ? "" : "\n  ") << "},\n";
+
+            out << "  \"bytes\": {";
+            first = true;
+            for (const auto& [format, size] : bytes) {
+                out << (first ? "" : ",") << "\"" << format << "\":" << size;
+                first = false;
+            }
+            out << "},\n";
+
+            out << "  \"peak_rss_kb\": " << peak_rss_kb() << "\n";
+            out << "}\n";
+        }
+
+        Profiler* current() {
+            return active.load(std::memory_order_relaxed);
+        }
+
+        Session::Session(Profiler* profiler) : previous_(active.exchange(profiler)) {}
+
+        Session::~Session() {
+            active.store(previous_);
+        }
+
+        Timer::Timer(Stage stage) : profiler_(current()), stage_(stage) {
+            if (profiler_) {
+                wall_start_ = wall_now_ns();
+                cpu_start_ = cpu_now_ns();
+            }
+        }
+
+        Timer::~Timer() {
+            if (profiler_) {
+                profiler_->add(stage_, wall_now_ns() - wall_start_, cpu_now_ns() - cpu_start_);
+            }
+        }
+
+        long peak_rss_kb() {
+            rusage usage {};
+            getrusage(RUSAGE_SELF, &usage);
+            // ru_maxrss is already in KiB on Linux
+            return usage.ru_maxrss;
+        }
+
+    } // namespace profile
+} // namespace rune
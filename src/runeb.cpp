@@ -0,0 +1,334 @@
+#include "rune/runeb.hpp"
+#include "rune/io.hpp"
+#include "rune/ramp.hpp"
+
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <zlib.h>
+
+namespace rune {
+    namespace runeb {
+
+        namespace {
+
+            // Largest grid side a reader accepts; a frame then needs at most 1.25 GB
+            constexpr int MAX_GRID_SIDE = 16384;
+
+            void put_u16(uint8_t* p, uint16_t v) {
+                p[0] = static_cast<uint8_t>(v);
+                p[1] = static_cast<uint8_t>(v >> 8);
+            }
+
+            void put_u32(uint8_t* p, uint32_t v) {
+                for (int i = 0; i < 4; ++i) p[i] = static_cast<uint8_t>(v >> (8 * i));
+            }
+
+            void put_u64(uint8_t* p, uint64_t v) {
+                for (int i = 0; i < 8; ++i) p[i] = static_cast<uint8_t>(v >> (8 * i));
+            }
+
+            uint16_t get_u16(const uint8_t* p) {
+                return static_cast<uint16_t>(p[0] | (p[1] << 8));
+            }
+
+            uint32_t get_u32(const uint8_t* p) {
+                uint32_t v = 0;
+                for (int i = 0; i < 4; ++i) v |= static_cast<uint32_t>(p[i]) << (8 * i);
+                return v;
+            }
+
+            uint64_t get_u64(const uint8_t* p) {
+                uint64_t v = 0;
+                for (int i = 0; i < 8; ++i) v |= static_cast<uint64_t>(p[i]) << (8 * i);
+                return v;
+            }
+
+            uint64_t pad_to_8(uint64_t offset) {
+                return (offset + 7) & ~uint64_t(7);
+            }
+
+            void encode_header(const Header& header, uint8_t* out) {
+                std::memset(out, 0, HEADER_SIZE);
+                std::memcpy(out, "RUNB", 4);
+                put_u16(out + 4, header.version);
+                put_u16(out + 6, header.flags);
+                put_u32(out + 8, static_cast<uint32_t>(header.cols));
+                put_u32(out + 12, static_cast<uint32_t>(header.rows));
+                put_u32(out + 16, static_cast<uint32_t>(header.fps));
+                put_u32(out + 20, static_cast<uint32_t>(header.frame_count));
+                put_u64(out + 24, header.index_offset);
+                put_u32(out + 32, static_cast<uint32_t>(header.glyph_table.size()));
+            }
+
+        } // namespace
+
+        Writer::~Writer() {
+            // Callers that care about write errors close() explicitly; here they can only be logged
+            try {
+                close();
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << "\n";
+            }
+        }
+
+        bool Writer::open(const std::string& path, int fps, bool deflate, int level, io::WriteQueue* queue) {
+            close();
+
+            if (queue) {
+                queue_file_ = queue->open(path, true);
+                if (queue_file_ < 0) {
+                    return false;
+                }
+                queue_ = queue;
+            } else {
+                out_.open(path, std::ios::binary | std::ios::trunc);
+                if (!out_) {
+                    return false;
+                }
+            }
+
+            header_ = Header {};
+            header_.fps = fps;
+            header_.flags = deflate ? FLAG_DEFLATE : 0;
+            index_.clear();
+            level_ = level;
+            offset_ = 0;
+            return true;
+        }
+
+        void Writer::write_frame(const CellBuffer& cells) {
+            if (!is_open()) {
+                throw std::runtime_error("runeb writer is not open");
+            }
+
+            // The first frame fixes the geometry and glyph table, written after the header
+            if (index_.empty()) {
+                header_.cols = cells.cols;
+                header_.rows = cells.rows;
+                header_.glyph_table = cells.glyph_table;
+
+                uint8_t header_bytes[HEADER_SIZE];
+                encode_header(header_, header_bytes);
+                put(header_bytes, HEADER_SIZE);
+                offset_ = HEADER_SIZE;
+
+                for (const auto& glyph : header_.glyph_table) {
+                    uint8_t len = static_cast<uint8_t>(glyph.size());
+                    put(&len, 1);
+                    put(glyph.data(), len);
+                    offset_ += 1 + len;
+                }
+            } else if (cells.cols != header_.cols || cells.rows != header_.rows) {
+                throw std::runtime_error("runeb frames must share one size");
+            }
+
+            const size_t count = cells.size();
+            planes_.resize(count * 5);
+
+            uint8_t* p = planes_.data();
+            for (size_t i = 0; i < count; ++i) {
+                put_u16(p + i * 2, cells.h[i]);
+            }
+            std::memcpy(p + count * 2, cells.glyphs.data(), count);
+            std::memcpy(p + count * 3, cells.s.data(), count);
+            std::memcpy(p + count * 4, cells.l.data(), count);
+
+            const uint8_t* payload = planes_.data();
+            uLongf stored = static_cast<uLongf>(planes_.size());
+
+            if (header_.flags & FLAG_DEFLATE) {
+                stored = compressBound(static_cast<uLong>(planes_.size()));
+                compressed_.resize(stored);
+                if (compress2(compressed_.data(), &stored, planes_.data(), static_cast<uLong>(planes_.size()), level_) != Z_OK) {
+                    throw std::runtime_error("runeb frame compression failed");
+                }
+                payload = compressed_.data();
+            }
+
+            // Align so Uint16Array views over the hue plane are valid
+            const uint64_t aligned = pad_to_8(offset_);
+            static const char zeros[8] = {};
+            put(zeros, aligned - offset_);
+
+            put(payload, stored);
+            if (!queue_ && !out_) {
+                throw std::runtime_error("runeb write failed");
+            }
+            index_.push_back(IndexEntry { aligned, static_cast<uint32_t>(stored), static_cast<uint32_t>(planes_.size()) });
+            offset_ = aligned + stored;
+        }
+
+        void Writer::close() {
+            if (!is_open()) {
+                return;
+            }
+
+            // An empty file still gets a valid header
+            if (index_.empty()) {
+                uint8_t header_bytes[HEADER_SIZE];
+                encode_header(header_, header_bytes);
+                put(header_bytes, HEADER_SIZE);
+                offset_ = HEADER_SIZE;
+            }
+
+            const uint64_t aligned = pad_to_8(offset_);
+            static const char zeros[8] = {};
+            put(zeros, aligned - offset_);
+
+            std::vector<uint8_t> index_bytes(index_.size() * 16);
+            for (size_t i = 0; i < index_.size(); ++i) {
+                put_u64(index_bytes.data() + i * 16, index_[i].offset);
+                put_u32(index_bytes.data() + i * 16 + 8, index_[i].stored_size);
+                put_u32(index_bytes.data() + i * 16 + 12, index_[i].raw_size);
+            }
+            put(index_bytes.data(), index_bytes.size());
+
+            header_.frame_count = static_cast<int>(index_.size());
+            header_.index_offset = aligned;
+
+            uint8_t header_bytes[HEADER_SIZE];
+            encode_header(header_, header_bytes);
+
+            if (queue_) {
+                queue_->write_at(queue_file_, 0, header_bytes, HEADER_SIZE);
+                const bool ok = queue_->close(queue_file_);
+                queue_ = nullptr;
+                queue_file_ = -1;
+                if (!ok) {
+                    throw std::runtime_error("runeb write failed");
+                }
+                return;
+            }
+
+            // A payload or the index that did not reach the disk (e.g. disk full) must not
+            // leave a file whose header looks complete
+            const bool written = static_cast<bool>(out_);
+            if (written) {
+                out_.seekp(0);
+                out_.write(reinterpret_cast<const char*>(header_bytes), HEADER_SIZE);
+            }
+            out_.close();
+            if (!written || out_.fail()) {
+                throw std::runtime_error("runeb write failed");
+            }
+        }
+
+        void Writer::put(const void* data, size_t size) {
+            if (queue_) {
+                queue_->write(queue_file_, data, size);
+            } else {
+                out_.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+            }
+        }
+
+        Reader::Reader(const std::string& path) : in_(path, std::ios::binary) {
+            if (!in_) {
+                throw std::runtime_error("failed to open runeb file");
+            }
+
+            uint8_t header_bytes[HEADER_SIZE];
+            if (!in_.read(reinterpret_cast<char*>(header_bytes), HEADER_SIZE) || std::memcmp(header_bytes, "RUNB", 4) != 0) {
+                throw std::runtime_error("not a runeb file");
+            }
+
+            header_.version = get_u16(header_bytes + 4);
+            if (header_.version != VERSION) {
+                throw std::runtime_error("unsupported runeb version");
+            }
+
+            header_.flags = get_u16(header_bytes + 6);
+            header_.cols = static_cast<int>(get_u32(header_bytes + 8));
+            header_.rows = static_cast<int>(get_u32(header_bytes + 12));
+            header_.fps = static_cast<int>(get_u32(header_bytes + 16));
+            header_.frame_count = static_cast<int>(get_u32(header_bytes + 20));
+            header_.index_offset = get_u64(header_bytes + 24);
+
+            // Header fields size the allocations below, so they are checked against
+            // the format's limits and the file's length before any is trusted
+            in_.seekg(0, std::ios::end);
+            const uint64_t file_size = static_cast<uint64_t>(in_.tellg());
+            in_.seekg(HEADER_SIZE);
+
+            if (header_.frame_count < 0) {
+                throw std::runtime_error("corrupt runeb header");
+            }
+            // A file without frames never fixed its geometry
+            const bool has_grid = header_.frame_count > 0;
+            if (header_.cols < (has_grid ? 1 : 0) || header_.cols > MAX_GRID_SIDE
+                || header_.rows < (has_grid ? 1 : 0) || header_.rows > MAX_GRID_SIDE) {
+                throw std::runtime_error("corrupt runeb header");
+            }
+            const uint64_t index_size = static_cast<uint64_t>(header_.frame_count) * 16;
+            if (header_.index_offset > file_size || index_size > file_size - header_.index_offset) {
+                throw std::runtime_error("truncated runeb index");
+            }
+
+            const uint32_t glyph_count = get_u32(header_bytes + 32);
+            if (glyph_count > static_cast<uint32_t>(CompiledRamp::MAX_GLYPHS)) {
+                throw std::runtime_error("corrupt runeb glyph table");
+            }
+            for (uint32_t i = 0; i < glyph_count; ++i) {
+                int len = in_.get();
+                if (len == EOF) throw std::runtime_error("truncated runeb glyph table");
+
+                std::string glyph(static_cast<size_t>(len), '\0');
+                if (!in_.read(glyph.data(), len)) throw std::runtime_error("truncated runeb glyph table");
+                header_.glyph_table.push_back(std::move(glyph));
+            }
+
+            std::vector<uint8_t> index_bytes(index_size);
+            in_.seekg(static_cast<std::streamoff>(header_.index_offset));
+            if (!in_.read(reinterpret_cast<char*>(index_bytes.data()), static_cast<std::streamsize>(index_bytes.size()))) {
+                throw std::runtime_error("truncated runeb index");
+            }
+
+            index_.resize(header_.frame_count);
+            for (int i = 0; i < header_.frame_count; ++i) {
+                const uint8_t* p = index_bytes.data() + static_cast<size_t>(i) * 16;
+                index_[i] = IndexEntry { get_u64(p), get_u32(p + 8), get_u32(p + 12) };
+
+                const IndexEntry& e = index_[i];
+                if (e.offset > file_size || e.stored_size > file_size - e.offset) {
+                    throw std::runtime_error("truncated runeb frame");
+                }
+            }
+        }
+
+        void Reader::read_frame(int frame, CellBuffer& cells) {
+            const IndexEntry& e = index_.at(frame);
+
+            const size_t count = static_cast<size_t>(header_.cols) * header_.rows;
+            if (e.raw_size != count * 5) {
+                throw std::runtime_error("corrupt runeb frame");
+            }
+
+            stored_.resize(e.stored_size);
+            in_.clear();
+            in_.seekg(static_cast<std::streamoff>(e.offset));
+            if (!in_.read(reinterpret_cast<char*>(stored_.data()), e.stored_size)) {
+                throw std::runtime_error("truncated runeb frame");
+            }
+
+            const uint8_t* p = stored_.data();
+            if (header_.flags & FLAG_DEFLATE) {
+                planes_.resize(e.raw_size);
+                uLongf raw = e.raw_size;
+                if (uncompress(planes_.data(), &raw, stored_.data(), e.stored_size) != Z_OK || raw != e.raw_size) {
+                    throw std::runtime_error("corrupt runeb frame");
+                }
+                p = planes_.data();
+            }
+
+            cells.glyph_table = header_.glyph_table;
+            cells.resize(header_.cols, header_.rows);
+            for (size_t i = 0; i < count; ++i) {
+                cells.h[i] = get_u16(p + i * 2);
+            }
+            std::memcpy(cells.glyphs.data(), p + count * 2, count);
+            std::memcpy(cells.s.data(), p + count * 3, count);
+            std::memcpy(cells.l.data(), p + count * 4, count);
+        }
+
+    } // namespace runeb
+} // namespace rune
@@ -0,0 +1,539 @@
+#include "rune/server.hpp"
+#include "rune/session.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace rune {
+    namespace server {
+
+        namespace {
+
+            // Largest payload a job may announce
+            constexpr size_t MAX_PAYLOAD = 64u << 20;
+            constexpr int MAX_SIDE = 16384;
+
+            // A client that stops sending mid-request, or stops reading its frames,
+            // releases its worker after this long
+            constexpr int RECEIVE_TIMEOUT_S = 10;
+            constexpr int SEND_TIMEOUT_S = 10;
+
+            // Whether a frame of this size may be converted: the same bound for raw
+            // payloads and for decoded images
+            bool frame_fits(int width, int height) {
+                return width >= 1 && width <= MAX_SIDE && height >= 1 && height <= MAX_SIDE
+                    && static_cast<size_t>(width) * height * 3 <= MAX_PAYLOAD;
+            }
+
+            double ms_since(Clock::time_point start) {
+                return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            }
+
+            // Error messages are plain text; only quotes, backslashes and control bytes need care
+            std::string error_line(std::string_view message) {
+                std::string line = "{\"error\":\"";
+                for (char c : message) {
+                    if (c == '"' || c == '\\') {
+                        line += '\\';
+                        line += c;
+                    } else if (static_cast<unsigned char>(c) >= 0x20) {
+                        line += c;
+                    }
+                }
+                line += "\"}\n";
+                return line;
+            }
+
+            template <typename T>
+            T parse_number(std::string_view key, std::string_view value) {
+                T result {};
+                const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), result);
+                if (ec != std::errc() || end != value.data() + value.size()) {
+                    throw std::runtime_error("bad value for " + std::string(key));
+                }
+                return result;
+            }
+
+            sockaddr_un socket_address(const std::string& path) {
+                sockaddr_un address {};
+                address.sun_family = AF_UNIX;
+                if (path.size() >= sizeof(address.sun_path)) {
+                    throw std::runtime_error("socket path is too long");
+                }
+                std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+                return address;
+            }
+
+            // The path goes into ffmpeg's shell command line, quoted
+            bool safe_video_path(const std::string& path) {
+                return path.find_first_of("\"$`\\\n") == std::string::npos && std::filesystem::is_regular_file(path);
+            }
+
+        } // namespace
+
+        Request parse_request(std::string_view line) {
+            Request request;
+
+            const size_t space = line.find(' ');
+            const std::string_view kind = line.substr(0, space);
+            if (kind == "IMAGE") request.kind = JobKind::Image;
+            else if (kind == "RAW") request.kind = JobKind::Raw;
+            else if (kind == "VIDEO") request.kind = JobKind::Video;
+            else if (kind == "STATS") request.kind = JobKind::Stats;
+            else throw std::runtime_error("unknown job kind");
+
+            std::string_view rest = space == std::string_view::npos ? std::string_view() : line.substr(space + 1);
+            while (!rest.empty()) {
+                const size_t eq = rest.find('=');
+                if (eq == std::string_view::npos) {
+                    throw std::runtime_error("expected key=value");
+                }
+                const std::string_view key = rest.substr(0, eq);
+
+                // The path runs to the end of the line
+                if (key == "path") {
+                    request.path = std::string(rest.substr(eq + 1));
+                    break;
+                }
+
+                const size_t end = rest.find(' ', eq);
+                const std::string_view value = rest.substr(eq + 1, end == std::string_view::npos ? std::string_view::npos : end - eq - 1);
+                rest = end == std::string_view::npos ? std::string_view() : rest.substr(end + 1);
+
+                if (key == "width") {
+                    request.width = parse_number<int>(key, value);
+                } else if (key == "ramp") {
+                    request.ramp = std::string(value);
+                } else if (key == "threshold") {
+                    request.threshold = parse_number<float>(key, value);
+                } else if (key == "encoding") {
+                    if (value != "json" && value != "html") throw std::runtime_error("encoding must be json or html");
+                    request.html = value == "html";
+                } else if (key == "bytes") {
+                    request.bytes = parse_number<size_t>(key, value);
+                } else if (key == "size") {
+                    const size_t x = value.find('x');
+                    if (x == std::string_view::npos) throw std::runtime_error("size must be WxH");
+                    request.raw_width = parse_number<int>(key, value.substr(0, x));
+                    request.raw_height = parse_number<int>(key, value.substr(x + 1));
+                } else if (key == "fps") {
+                    request.fps = parse_number<int>(key, value);
+                } else if (key == "keyframes") {
+                    request.keyframe_interval = parse_number<int>(key, value);
+                } else {
+                    throw std::runtime_error("unknown field " + std::string(key));
+                }
+            }
+
+            if (request.width < 1 || request.width > MAX_SIDE) throw std::runtime_error("width out of range");
+            if (request.fps < 1 || request.fps > 240) throw std::runtime_error("fps out of range");
+            if (request.kind == JobKind::Image && (request.bytes == 0 || request.bytes > MAX_PAYLOAD)) {
+                throw std::runtime_error("bytes out of range");
+            }
+            if (request.kind == JobKind::Raw && !frame_fits(request.raw_width, request.raw_height)) {
+                throw std::runtime_error("size out of range");
+            }
+            if (request.kind == JobKind::Video && request.path.empty()) {
+                throw std::runtime_error("video needs a path");
+            }
+            return request;
+        }
+
+        std::string format_request(const Request& request) {
+            std::string line;
+            switch (request.kind) {
+                case JobKind::Image: line = "IMAGE"; break;
+                case JobKind::Raw: line = "RAW"; break;
+                case JobKind::Video: line = "VIDEO"; break;
+                case JobKind::Stats: return "STATS\n";
+            }
+
+            line += " width=" + std::to_string(request.width);
+            line += " ramp=" + request.ramp;
+            if (request.threshold != 1.0f) {
+                char number[32];
+                line += " threshold=";
+                line.append(number, std::to_chars(number, number + sizeof(number), request.threshold).ptr);
+            }
+            if (request.html) line += " encoding=html";
+
+            if (request.kind == JobKind::Image) {
+                line += " bytes=" + std::to_string(request.bytes);
+            } else if (request.kind == JobKind::Raw) {
+                line += " size=" + std::to_string(request.raw_width) + "x" + std::to_string(request.raw_height);
+            } else {
+                line += " fps=" + std::to_string(request.fps);
+                if (request.keyframe_interval > 0) line += " keyframes=" + std::to_string(request.keyframe_interval);
+                line += " path=" + request.path;
+            }
+            return line + "\n";
+        }
+
+        const rune::Ramp* find_ramp(std::string_view name) {
+            if (name == "simple") return &rune::ramps::SIMPLE;
+            if (name == "dense") return &rune::ramps::DENSE;
+            if (name == "blocks") return &rune::ramps::BLOCKS;
+            if (name == "dot") return &rune::ramps::DOT;
+            if (name == "line") return &rune::ramps::LINE;
+            return nullptr;
+        }
+
+        Connection::Connection(Connection&& other) noexcept : fd_(other.fd_), pending_(std::move(other.pending_)) {
+            other.fd_ = -1;
+        }
+
+        Connection::~Connection() {
+            if (fd_ >= 0) {
+                ::close(fd_);
+            }
+        }
+
+        bool Connection::read_line(std::string& line, size_t max_size) {
+            size_t scanned = 0;
+            for (;;) {
+                const size_t newline = pending_.find('\n', scanned);
+                if (newline != std::string::npos) {
+                    line.assign(pending_, 0, newline);
+                    pending_.erase(0, newline + 1);
+                    return true;
+                }
+                if (pending_.size() > max_size) {
+                    return false;
+                }
+                scanned = pending_.size();
+
+                char chunk[4096];
+                const ssize_t n = ::recv(fd_, chunk, sizeof(chunk), 0);
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) return false;
+                pending_.append(chunk, static_cast<size_t>(n));
+            }
+        }
+
+        bool Connection::read_exact(void* data, size_t size) {
+            char* out = static_cast<char*>(data);
+
+            // Whatever arrived together with the header line comes first
+            const size_t buffered = std::min(size, pending_.size());
+            std::memcpy(out, pending_.data(), buffered);
+            pending_.erase(0, buffered);
+            out += buffered;
+            size -= buffered;
+
+            while (size > 0) {
+                const ssize_t n = ::recv(fd_, out, size, 0);
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) return false;
+                out += n;
+                size -= static_cast<size_t>(n);
+            }
+            return true;
+        }
+
+        bool Connection::write_all(std::string_view data) {
+            const char* p = data.data();
+            size_t left = data.size();
+            while (left > 0) {
+                // MSG_NOSIGNAL: a client that hung up is an error here, not a SIGPIPE
+                const ssize_t n = ::send(fd_, p, left, MSG_NOSIGNAL);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    return false;
+                }
+                p += n;
+                left -= static_cast<size_t>(n);
+            }
+            return true;
+        }
+
+        Connection connect(const std::string& socket_path) {
+            const sockaddr_un address = socket_address(socket_path);
+
+            const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (fd < 0) {
+                throw std::runtime_error("socket failed");
+            }
+            Connection connection(fd);
+            if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+                throw std::runtime_error(std::string("connect failed: ") + std::strerror(errno));
+            }
+            return connection;
+        }
+
+        LatencyStats::LatencyStats(size_t window) : window_(std::max<size_t>(1, window)) {}
+
+        void LatencyStats::record(double ms) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (samples_.size() < window_) {
+                samples_.push_back(ms);
+            } else {
+                samples_[next_] = ms;
+            }
+            next_ = (next_ + 1) % window_;
+            count_++;
+        }
+
+        std::string LatencyStats::json() const {
+            std::vector<double> sorted;
+            uint64_t count;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                sorted = samples_;
+                count = count_;
+            }
+            std::sort(sorted.begin(), sorted.end());
+
+            auto percentile = [&sorted](double p) {
+                if (sorted.empty()) return 0.0;
+                const size_t rank = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+                return sorted[rank];
+            };
+
+            char text[160];
+            std::snprintf(text, sizeof(text), "{\"count\":%llu,\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"max\":%.3f}",
+                static_cast<unsigned long long>(count), percentile(0.5), percentile(0.9), percentile(0.99),
+                sorted.empty() ? 0.0 : sorted.back());
+            return text;
+        }
+
+        Server::Server(const ServerOptions& options) : options_(options) {
+            const sockaddr_un address = socket_address(options_.socket_path);
+
+            listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (listen_fd_ < 0) {
+                throw std::runtime_error("socket failed");
+            }
+
+            // A socket file left behind by an earlier server would make bind fail
+            ::unlink(options_.socket_path.c_str());
+            if (::bind(listen_fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+                || ::listen(listen_fd_, SOMAXCONN) != 0) {
+                const std::string reason = std::strerror(errno);
+                ::close(listen_fd_);
+                throw std::runtime_error("cannot listen on " + options_.socket_path + ": " + reason);
+            }
+        }
+
+        Server::~Server() {
+            ::close(listen_fd_);
+            ::unlink(options_.socket_path.c_str());
+        }
+
+        void Server::run(const std::atomic<bool>& stop) {
+            std::vector<std::thread> workers;
+            for (int i = 0; i < std::max(1, options_.threads); ++i) {
+                workers.emplace_back([this] { work(); });
+            }
+
+            while (!stop) {
+                pollfd ready { listen_fd_, POLLIN, 0 };
+                if (::poll(&ready, 1, 200) <= 0) {
+                    continue;
+                }
+
+                const int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+                if (fd < 0) {
+                    continue;
+                }
+
+                // Admission control: past the queue limit a job is refused rather than left waiting
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (queue_.size() < static_cast<size_t>(std::max(0, options_.queue_limit))) {
+                        queue_.push_back(Job { fd, Clock::now() });
+                        queue_cv_.notify_one();
+                        continue;
+                    }
+                }
+
+                rejected_++;
+                Connection refused(fd);
+                refused.write_all(error_line("busy"));
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopping_ = true;
+            }
+            queue_cv_.notify_all();
+            for (std::thread& worker : workers) {
+                worker.join();
+            }
+        }
+
+        void Server::work() {
+            // Reused across this worker's jobs; no other worker touches it
+            std::vector<uint8_t> payload;
+
+            for (;;) {
+                Job job;
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    queue_cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+                    if (queue_.empty()) {
+                        return;
+                    }
+                    job = queue_.front();
+                    queue_.pop_front();
+                }
+
+                timeval receive_timeout { RECEIVE_TIMEOUT_S, 0 };
+                ::setsockopt(job.fd, SOL_SOCKET, SO_RCVTIMEO, &receive_timeout, sizeof(receive_timeout));
+                timeval send_timeout { SEND_TIMEOUT_S, 0 };
+                ::setsockopt(job.fd, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout));
+
+                Connection connection(job.fd);
+                active_++;
+                try {
+                    serve(connection, job.accepted, payload);
+                } catch (const std::exception& e) {
+                    failed_++;
+                    connection.write_all(error_line(e.what()));
+                }
+                active_--;
+            }
+        }
+
+        void Server::serve(Connection& connection, Clock::time_point accepted, std::vector<uint8_t>& payload) {
+            const double queue_ms = ms_since(accepted);
+
+            std::string header;
+            if (!connection.read_line(header)) {
+                throw std::runtime_error("missing request line");
+            }
+            const Request request = parse_request(header);
+
+            if (request.kind == JobKind::Stats) {
+                connection.write_all(stats_json() + "\n");
+                return;
+            }
+
+            const rune::Ramp* ramp = find_ramp(request.ramp);
+            if (!ramp) {
+                throw std::runtime_error("unknown ramp " + request.ramp);
+            }
+
+            converter::ConvertOptions options = options_.convert;
+            options.keyframe_interval = request.kind == JobKind::Video ? request.keyframe_interval : 0;
+            options.palette_size = 0;
+            session::Session session(request.width, *ramp, request.threshold, options);
+            const session::Encoding encoding = request.html ? session::Encoding::Html : session::Encoding::Json;
+
+            double convert_ms = 0.0;
+            bool connected = true;
+            auto send_frame = [&](converter::ImageView frame) {
+                const Clock::time_point started = Clock::now();
+                session.feed(frame);
+                convert_ms += ms_since(started);
+                session.encode(encoding, [&](std::string_view bytes) {
+                    if (connected) connected = connection.write_all(bytes);
+                });
+            };
+
+            if (request.kind == JobKind::Image || request.kind == JobKind::Raw) {
+                const size_t size = request.kind == JobKind::Image
+                    ? request.bytes
+                    : static_cast<size_t>(request.raw_width) * request.raw_height * 3;
+                payload.resize(size);
+                if (!connection.read_exact(payload.data(), size)) {
+                    throw std::runtime_error("payload ended early");
+                }
+
+                if (request.kind == JobKind::Raw) {
+                    // Converted straight out of the receive buffer
+                    send_frame(converter::ImageView(payload.data(), request.raw_width, request.raw_height));
+                } else {
+                    // The header gives the size, so an image too large to hold is refused
+                    // before any of it is decoded
+                    int image_width = 0, image_height = 0;
+                    if (!converter::probe_image(payload.data(), payload.size(), image_width, image_height)) {
+                        throw std::runtime_error("Failed to decode image");
+                    }
+                    if (!frame_fits(image_width, image_height)) {
+                        throw std::runtime_error("image too large");
+                    }
+
+                    const Clock::time_point started = Clock::now();
+                    const converter::ImageBuffer image = converter::decode_image_pixels(payload.data(), payload.size());
+                    convert_ms += ms_since(started);
+                    send_frame(image);
+                }
+            } else {
+                if (!safe_video_path(request.path)) {
+                    throw std::runtime_error("no such video file");
+                }
+
+                const converter::VideoInfo info = converter::probe_video(request.path, request.fps);
+                std::FILE* pipe = converter::open_video_frames(request.path, request.fps, info);
+
+                converter::ImageBuffer frame;
+                try {
+                    // Frames go out as they are decoded; a client that hangs up ends the job
+                    while (connected) {
+                        frame.width = info.width;
+                        frame.height = info.height;
+                        frame.channels = 3;
+                        if (!converter::read_raw_frame(pipe, frame)) break;
+                        send_frame(frame);
+                    }
+                } catch (...) {
+                    pclose(pipe);
+                    throw;
+                }
+
+                // Stopping early leaves ffmpeg with a closed pipe, which is not a failure
+                const int status = pclose(pipe);
+                if (connected && status != 0) {
+                    throw std::runtime_error("ffmpeg failed");
+                }
+            }
+
+            const double total_ms = ms_since(accepted);
+            char done[160];
+            std::snprintf(done, sizeof(done), "{\"done\":{\"frames\":%llu,\"queue_ms\":%.3f,\"convert_ms\":%.3f,\"total_ms\":%.3f}}\n",
+                static_cast<unsigned long long>(session.frames()), queue_ms, convert_ms, total_ms);
+            if (connected) {
+                connection.write_all(done);
+            }
+
+            requests_++;
+            latency_.record(total_ms);
+
+            if (options_.log) {
+                static std::mutex log_mutex;
+                std::lock_guard<std::mutex> lock(log_mutex);
+                std::cerr << done;
+            }
+        }
+
+        std::string Server::stats_json() const {
+            size_t queued;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                queued = queue_.size();
+            }
+
+            return "{\"requests\":" + std::to_string(requests_.load())
+                + ",\"failed\":" + std::to_string(failed_.load())
+                + ",\"rejected\":" + std::to_string(rejected_.load())
+                + ",\"active\":" + std::to_string(active_.load())
+                + ",\"queued\":" + std::to_string(queued)
+                + ",\"threads\":" + std::to_string(options_.threads)
+                + ",\"queue_limit\":" + std::to_string(options_.queue_limit)
+                + ",\"latency_ms\":" + latency_.json() + "}";
+        }
+
+    } // namespace server
+} // namespace rune
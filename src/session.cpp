@@ -0,0 +1,104 @@
+#include "rune/session.hpp"
+#include "rune/profile.hpp"
+
+#include <stdexcept>
+
+namespace rune {
+    namespace session {
+
+        Session::Session(int target_width, const rune::Ramp& ramp, float threshold, const converter::ConvertOptions& options)
+            : target_width_(target_width), ramp_(ramp), threshold_(threshold), options_(options) {
+            if (target_width <= 0) {
+                throw std::runtime_error("session width must be positive");
+            }
+
+            lut_ = converter::lut_for(ramp, threshold, options);
+            cache_ = converter::cache_for(options);
+            context_.cache = cache_.get();
+
+            if (options.palette_size > 0) {
+                palette_ = std::make_unique<palette::Palette>(options.palette_size);
+            }
+            if (options.keyframe_interval > 1) {
+                delta_ = std::make_unique<writer::DeltaEncoder>(options.keyframe_interval, options.delta_tolerance);
+            }
+        }
+
+        Session::~Session() = default;
+
+        void Session::feed(converter::ImageView frame) {
+            if (!frame.pixels || frame.width <= 0 || frame.height <= 0 || frame.channels < 3) {
+                throw std::runtime_error("session frame must be RGB pixels with a positive size");
+            }
+
+            converter::convert_frame_to_ascii(frame, target_width_, ramp_, threshold_, lut_.get(), context_, frame_);
+            frames_++;
+
+            json_ready_ = false;
+            html_ready_ = false;
+            ansi_ = nullptr;
+        }
+
+        const converter::AsciiFrame& Session::current() const {
+            if (frames_ == 0) {
+                throw std::runtime_error("no frame has been fed to the session");
+            }
+            return frame_;
+        }
+
+        void Session::read_cells(const std::function<void(const rune::CellBuffer&)>& callback) const {
+            callback(current().cells);
+        }
+
+        void Session::read_cells(rune::CellBuffer& cells) const {
+            const rune::CellBuffer& source = current().cells;
+
+            cells.glyph_table = source.glyph_table;
+            cells.resize(source.cols, source.rows);
+            cells.glyphs.assign(source.glyphs.begin(), source.glyphs.end());
+            cells.h.assign(source.h.begin(), source.h.end());
+            cells.s.assign(source.s.begin(), source.s.end());
+            cells.l.assign(source.l.begin(), source.l.end());
+        }
+
+        size_t Session::encode(Encoding encoding, const Sink& sink) {
+            const rune::CellBuffer& cells = current().cells;
+
+            switch (encoding) {
+                case Encoding::Json: {
+                    // The delta encoder advances once per frame, however often the frame is encoded
+                    if (!json_ready_) {
+                        profile::Timer timer(profile::Stage::Serialize);
+                        json_ = (delta_ && !delta_->encode(cells, spans_))
+                            ? serializer_.serialize_delta(cells, spans_)
+                            : serializer_.serialize_cells(cells);
+                        json_ready_ = true;
+                    }
+                    sink(json_);
+                    return json_.size();
+                }
+
+                case Encoding::Html: {
+                    if (!html_ready_) {
+                        converter::add_html(frame_, palette_.get());
+                        html_ready_ = true;
+                    }
+                    sink(frame_.html);
+                    sink("\n");
+                    return frame_.html.size() + 1;
+                }
+
+                case Encoding::Ansi: {
+                    // The renderer diffs against the previous render, so it also runs once per frame
+                    if (!ansi_) {
+                        ansi_ = &renderer_.render(cells);
+                    }
+                    sink(*ansi_);
+                    return ansi_->size();
+                }
+            }
+            return 0;
+        }
+
+    } // namespace session
+} // namespace rune
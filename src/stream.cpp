@@ -0,0 +1,166 @@
+#include "rune/stream.hpp"
+#include "rune/profile.hpp"
+#include "rune/session.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <string_view>
+#include <thread>
+
+namespace rune {
+    namespace stream {
+
+        namespace {
+
+            using Clock = std::chrono::steady_clock;
+
+            // Single-slot mailbox between the reader and the converter: a new frame
+            // replaces one that has not been picked up yet
+            struct FrameSlot {
+                std::mutex mutex;
+                std::condition_variable ready_cv;
+                rune::converter::ImageBuffer frame;
+                Clock::time_point arrival;
+                uint64_t index = 0;
+                bool full = false;
+                bool done = false;
+                bool stop = false;
+            };
+
+        } // namespace
+
+        StreamStats stream_raw_to_ascii(std::FILE* in, int frame_width, int frame_height, int target_width, int target_fps, std::FILE* out, std::FILE* report, const rune::Ramp& ramp, float threshold, const rune::converter::ConvertOptions& options) {
+            // Static scenes repeat frames, which the session's optional cache turns into copies
+            session::Session session(target_width, ramp, threshold, options);
+
+            StreamStats stats;
+            FrameSlot slot;
+            std::exception_ptr reader_error;
+
+            const Clock::duration period = target_fps > 0
+                ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / target_fps))
+                : Clock::duration::zero();
+
+            std::thread reader([&] {
+                rune::converter::ImageBuffer incoming;
+                Clock::time_point next_due {};
+
+                try {
+                    for (;;) {
+                        // Buffers circulate through the slot, so the geometry is set on every read
+                        incoming.width = frame_width;
+                        incoming.height = frame_height;
+                        incoming.channels = 3;
+                        {
+                            profile::Timer timer(profile::Stage::Input);
+                            if (!rune::converter::read_raw_frame(in, incoming)) break;
+                        }
+
+                        const Clock::time_point arrival = Clock::now();
+
+                        std::lock_guard<std::mutex> lock(slot.mutex);
+                        if (slot.stop) break;
+                        const uint64_t index = stats.frames_in++;
+
+                        // Hold the target rate; a quarter-period of slack absorbs source jitter
+                        if (period != Clock::duration::zero()) {
+                            if (index != 0 && arrival < next_due - period / 4) {
+                                stats.skipped++;
+                                continue;
+                            }
+                            next_due = std::max(next_due + period, arrival);
+                        }
+
+                        if (slot.full) {
+                            stats.dropped++;
+                        }
+                        std::swap(slot.frame, incoming);
+                        slot.arrival = arrival;
+                        slot.index = index;
+                        slot.full = true;
+                        slot.ready_cv.notify_one();
+                    }
+                } catch (...) {
+                    reader_error = std::current_exception();
+                }
+
+                std::lock_guard<std::mutex> lock(slot.mutex);
+                slot.done = true;
+                slot.ready_cv.notify_one();
+            });
+
+            rune::converter::ImageBuffer frame;
+            try {
+                for (;;) {
+                    Clock::time_point arrival;
+                    uint64_t index;
+                    {
+                        std::unique_lock<std::mutex> lock(slot.mutex);
+                        slot.ready_cv.wait(lock, [&] { return slot.full || slot.done; });
+                        if (!slot.full) break;
+
+                        std::swap(frame, slot.frame);
+                        arrival = slot.arrival;
+                        index = slot.index;
+                        slot.full = false;
+                    }
+
+                    session.feed(frame);
+
+                    bool written = true;
+                    session.encode(session::Encoding::Json, [&](std::string_view line) {
+                        written = std::fwrite(line.data(), 1, line.size(), out) == line.size();
+                    });
+
+                    if (!written || std::fflush(out) != 0) {
+                        // The consumer went away
+                        break;
+                    }
+
+                    const double latency_ms = std::chrono::duration<double, std::milli>(Clock::now() - arrival).count();
+                    if (profile::Profiler* profiler = profile::current()) {
+                        profiler->frame_done(latency_ms);
+                    }
+
+                    uint64_t skipped, dropped;
+                    {
+                        std::lock_guard<std::mutex> lock(slot.mutex);
+                        stats.frames_out++;
+                        skipped = stats.skipped;
+                        dropped = stats.dropped;
+                    }
+
+                    if (report) {
+                        std::fprintf(report, "{\"frame\":%llu,\"latency_ms\":%.3f,\"skipped\":%llu,\"dropped\":%llu}\n",
+                            static_cast<unsigned long long>(index), latency_ms,
+                            static_cast<unsigned long long>(skipped), static_cast<unsigned long long>(dropped));
+                    }
+                }
+            } catch (...) {
+                // The reader exits after the frame it is blocked on
+                {
+                    std::lock_guard<std::mutex> lock(slot.mutex);
+                    slot.stop = true;
+                }
+                reader.join();
+                throw;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(slot.mutex);
+                slot.stop = true;
+            }
+            reader.join();
+            if (reader_error) {
+                std::rethrow_exception(reader_error);
+            }
+
+            std::lock_guard<std::mutex> lock(slot.mutex);
+            return stats;
+        }
+
+    } // namespace stream
+} // namespace rune
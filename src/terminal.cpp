@@ -0,0 +1,164 @@
+#include "rune/terminal.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+namespace rune {
+    namespace terminal {
+
+        namespace {
+
+            void append_uint(std::string& out, unsigned value) {
+                char digits[10];
+                auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), value);
+                out.append(digits, static_cast<size_t>(end - digits));
+            }
+
+            float hue_to_channel(float p, float q, float t) {
+                if (t < 0.0f) t += 1.0f;
+                if (t > 1.0f) t -= 1.0f;
+                if (t < 1.0f / 6.0f) return p + (q - p) * 6.0f * t;
+                if (t < 1.0f / 2.0f) return q;
+                if (t < 2.0f / 3.0f) return p + (q - p) * (2.0f / 3.0f - t) * 6.0f;
+                return p;
+            }
+
+        } // namespace
+
+        Rgb hsl_to_rgb(int h, int s, int l) {
+            const float hf = static_cast<float>(h % 360) / 360.0f;
+            const float sf = static_cast<float>(s) / 100.0f;
+            const float lf = static_cast<float>(l) / 100.0f;
+
+            if (sf == 0.0f) {
+                const uint8_t v = static_cast<uint8_t>(std::lround(lf * 255.0f));
+                return Rgb { v, v, v };
+            }
+
+            const float q = lf < 0.5f ? lf * (1.0f + sf) : lf + sf - lf * sf;
+            const float p = 2.0f * lf - q;
+
+            return Rgb {
+                static_cast<uint8_t>(std::lround(hue_to_channel(p, q, hf + 1.0f / 3.0f) * 255.0f)),
+                static_cast<uint8_t>(std::lround(hue_to_channel(p, q, hf) * 255.0f)),
+                static_cast<uint8_t>(std::lround(hue_to_channel(p, q, hf - 1.0f / 3.0f) * 255.0f))
+            };
+        }
+
+        const char* Renderer::begin_sequence() {
+            return "\x1b[?25l\x1b[2J\x1b[H";
+        }
+
+        const char* Renderer::end_sequence() {
+            return "\x1b[0m\x1b[?25h\n";
+        }
+
+        void Renderer::move_to(int row, int col) {
+            if (row == cursor_row_ && col == cursor_col_) {
+                return;
+            }
+
+            // CUP is 1-based
+            out_ += "\x1b[";
+            append_uint(out_, static_cast<unsigned>(row + 1));
+            out_ += ';';
+            append_uint(out_, static_cast<unsigned>(col + 1));
+            out_ += 'H';
+            cursor_row_ = row;
+            cursor_col_ = col;
+        }
+
+        void Renderer::set_colour(uint16_t h, uint8_t s, uint8_t l) {
+            const int key = (h << 14) | (s << 7) | l;
+            if (key == colour_) {
+                return;
+            }
+
+            const Rgb rgb = hsl_to_rgb(h, s, l);
+            out_ += "\x1b[38;2;";
+            append_uint(out_, rgb.r);
+            out_ += ';';
+            append_uint(out_, rgb.g);
+            out_ += ';';
+            append_uint(out_, rgb.b);
+            out_ += 'm';
+            colour_ = key;
+        }
+
+        void Renderer::emit_cell(const CellBuffer& cells, size_t i) {
+            const int row = static_cast<int>(i / cells.cols);
+            const int col = static_cast<int>(i % cells.cols);
+
+            move_to(row, col);
+            set_colour(cells.h[i], cells.s[i], cells.l[i]);
+            out_ += ansi_[cells.glyphs[i]].view();
+
+            // Every ramp glyph is one column wide
+            cursor_col_ = col + 1;
+            ++changed_;
+        }
+
+        const std::string& Renderer::render(const CellBuffer& cells) {
+            out_.clear();
+            changed_ = 0;
+
+            // A table that only grew (a JSONL reader appends glyphs as it first meets
+            // them) keeps every index the previous frame used, so diffing goes on
+            const size_t known = previous_.glyph_table.size();
+            const bool extends = cells.glyph_table.size() >= known
+                && std::equal(previous_.glyph_table.begin(), previous_.glyph_table.end(), cells.glyph_table.begin());
+
+            const bool full = !valid_
+                || cells.cols != previous_.cols
+                || cells.rows != previous_.rows
+                || !extends;
+
+            if (!full && cells.glyph_table.size() > known) {
+                for (size_t g = known; g < cells.glyph_table.size(); ++g) {
+                    previous_.glyph_table.push_back(cells.glyph_table[g]);
+                    ansi_.push_back(glyph_encoding::ansi(cells.glyph_table[g]));
+                }
+            }
+
+            out_ += "\x1b[?2026h";
+
+            if (full) {
+                out_ += "\x1b[2J";
+                cursor_row_ = -1;
+                cursor_col_ = -1;
+                colour_ = -1;
+
+                // Glyphs are encoded for the terminal once per glyph table
+                ansi_.clear();
+                for (const std::string& glyph : cells.glyph_table) ansi_.push_back(glyph_encoding::ansi(glyph));
+
+                for (size_t i = 0; i < cells.size(); ++i) {
+                    emit_cell(cells, i);
+                }
+            } else {
+                for (size_t i = 0; i < cells.size(); ++i) {
+                    if (cells.glyphs[i] != previous_.glyphs[i] || cells.h[i] != previous_.h[i]
+                        || cells.s[i] != previous_.s[i] || cells.l[i] != previous_.l[i]) {
+                        emit_cell(cells, i);
+                    }
+                }
+            }
+
+            out_ += "\x1b[?2026l";
+
+            // Keep the frame for the next diff, reusing the planes' capacity
+            previous_.cols = cells.cols;
+            previous_.rows = cells.rows;
+            if (full) previous_.glyph_table = cells.glyph_table;
+            previous_.glyphs.assign(cells.glyphs.begin(), cells.glyphs.end());
+            previous_.h.assign(cells.h.begin(), cells.h.end());
+            previous_.s.assign(cells.s.begin(), cells.s.end());
+            previous_.l.assign(cells.l.begin(), cells.l.end());
+            valid_ = true;
+
+            return out_;
+        }
+
+    } // namespace terminal
+} // namespace rune
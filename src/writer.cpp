@@ -1,9 +1,20 @@
 #include "rune/cell.hpp"
 #include "rune/converter.hpp"
+#include "rune/writer.hpp"
+#include "rune/profile.hpp"
+#include "rune/ramp.hpp"
 #include <ostream>
 #include <iomanip>
 #include <cstdint>
 #include <sstream>
+#include <charconv>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+#include <filesystem>
 
 namespace rune {
     namespace writer {
@@ -58,65 +69,122 @@ namespace rune {
         //         out << "}\n";
         // }
 
-        void write_cells(
-            std::ostream& out,
-            rune::converter::ImageBuffer& image_buffer,
-            const std::vector<rune::Cell>& cells
-        ) {
+        JsonSerializer::JsonSerializer() = default;
+
+        void JsonSerializer::prepare_glyphs(const std::vector<std::string>& glyph_table) {
+            // Glyphs are escaped once per ramp, not once per cell
+            if (glyph_table == glyph_table_) {
+                return;
+            }
+
+            glyph_table_ = glyph_table;
+            escaped_.clear();
+            max_escaped_ = 0;
+
+            // Same encoding as CompiledRamp::json
+            for (const std::string& glyph : glyph_table_) {
+                std::string escaped(glyph_encoding::json(glyph).view());
+                max_escaped_ = std::max(max_escaped_, escaped.size());
+                escaped_.push_back(std::move(escaped));
+            }
+        }
+
+        char* JsonSerializer::begin(size_t cells, size_t spans) {
+            // Upper bound: {"g":"<glyph>","h":65535,"s":255,"l":255}, per cell, plus span headers
+            const size_t bound = 16 + cells * (max_escaped_ + 40) + spans * 40;
+            if (buffer_.size() < bound) {
+                buffer_.resize(bound);
+            }
+            return buffer_.data();
+        }
 
-            out << R"({"cells":[)";
+        namespace {
+
+            template <size_t N>
+            char* put(char* p, const char (&literal)[N]) {
+                std::memcpy(p, literal, N - 1);
+                return p + N - 1;
+            }
+
+            char* put_int(char* p, unsigned value) {
+                return std::to_chars(p, p + 10, value).ptr;
+            }
+
+        } // namespace
+
+        char* JsonSerializer::put_cell(char* p, const rune::CellBuffer& cells, size_t i) const {
+            const std::string& glyph = escaped_[cells.glyphs[i]];
+
+            p = put(p, R"({"g":")");
+            std::memcpy(p, glyph.data(), glyph.size());
+            p += glyph.size();
+            p = put(p, R"(","h":)");
+            p = put_int(p, cells.h[i]);
+            p = put(p, R"(,"s":)");
+            p = put_int(p, cells.s[i]);
+            p = put(p, R"(,"l":)");
+            p = put_int(p, cells.l[i]);
+            *p++ = '}';
+            return p;
+        }
+
+        std::string_view JsonSerializer::serialize_cells(const rune::CellBuffer& cells) {
+            prepare_glyphs(cells.glyph_table);
+
+            char* const start = begin(cells.size(), 0);
+            char* p = put(start, R"({"cells":[)");
 
             for (size_t i = 0; i < cells.size(); ++i) {
-                const auto& c = cells[i];
-
-                out << R"({"g":")";
-
-                // Escape special JSON characters and encode UTF-8 as \uXXXX
-                if (c.glyph == "\\") {
-                    out << "\\\\";
-                } else if (c.glyph == "\"") {
-                    out << "\\\"";
-                } else if (c.glyph == "\b") {
-                    out << "\\b";
-                } else if (c.glyph == "\f") {
-                    out << "\\f";
-                } else if (c.glyph == "\n") {
-                    out << "\\n";
-                } else if (c.glyph == "\r") {
-                    out << "\\r";
-                } else if (c.glyph == "\t") {
-                    out << "\\t";
-                } else if (c.glyph.size() == 1 && static_cast<unsigned char>(c.glyph[0]) < 128) {
-                    // ASCII character - output directly
-                    out << c.glyph;
-                } else {
-                    // Multi-byte UTF-8 - convert to Unicode code point and escape as \uXXXX
-                    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(c.glyph.data());
-                    uint32_t codepoint = 0;
-                    
-                    if ((bytes[0] & 0x80) == 0) {
-                        codepoint = bytes[0];
-                    } else if ((bytes[0] & 0xE0) == 0xC0 && c.glyph.size() >= 2) {
-                        codepoint = ((bytes[0] & 0x1F) << 6) | (bytes[1] & 0x3F);
-                    } else if ((bytes[0] & 0xF0) == 0xE0 && c.glyph.size() >= 3) {
-                        codepoint = ((bytes[0] & 0x0F) << 12) | ((bytes[1] & 0x3F) << 6) | (bytes[2] & 0x3F);
-                    } else if ((bytes[0] & 0xF8) == 0xF0 && c.glyph.size() >= 4) {
-                        codepoint = ((bytes[0] & 0x07) << 18) | ((bytes[1] & 0x3F) << 12) | ((bytes[2] & 0x3F) << 6) | (bytes[3] & 0x3F);
-                    }
-                    
-                    // Output as \uXXXX
-                    out << "\\u" << std::hex << std::setfill('0') << std::setw(4) << codepoint << std::dec;
-                }
+                if (i != 0) *p++ = ',';
+                p = put_cell(p, cells, i);
+            }
+
+            p = put(p, "]}\n");
+            return std::string_view(start, static_cast<size_t>(p - start));
+        }
+
+        std::string_view JsonSerializer::serialize_delta(const rune::CellBuffer& cells, const std::vector<CellSpan>& spans) {
+            prepare_glyphs(cells.glyph_table);
 
-                out << R"(","h":)" << static_cast<int>(c.h) << R"(,"s":)" << static_cast<int>(c.s * 100.0f) << R"(,"l":)" << static_cast<int>(c.l * 100.0f) << R"(})";
+            size_t changed = 0;
+            for (const CellSpan& span : spans) changed += span.end - span.begin;
 
-                if (i + 1 < cells.size()) {
-                    out << ",";
+            char* const start = begin(changed, spans.size());
+            char* p = put(start, R"({"d":[)");
+
+            for (size_t k = 0; k < spans.size(); ++k) {
+                if (k != 0) *p++ = ',';
+
+                p = put(p, R"({"i":)");
+                p = put_int(p, spans[k].begin);
+                p = put(p, R"(,"cells":[)");
+                for (uint32_t i = spans[k].begin; i < spans[k].end; ++i) {
+                    if (i != spans[k].begin) *p++ = ',';
+                    p = put_cell(p, cells, i);
                 }
+                p = put(p, "]}");
+            }
+
+            p = put(p, "]}\n");
+            return std::string_view(start, static_cast<size_t>(p - start));
+        }
+
+        namespace {
 
+            // Per-thread serializer so the free-standing writers stay allocation-free too
+            JsonSerializer& local_serializer() {
+                thread_local JsonSerializer serializer;
+                return serializer;
             }
 
-            out << R"(]})" << "\n";
+        } // namespace
+
+        void write_cells(
+            std::ostream& out,
+            const rune::CellBuffer& cells
+        ) {
+            std::string_view frame = local_serializer().serialize_cells(cells);
+            out.write(frame.data(), static_cast<std::streamsize>(frame.size()));
         }
 
         void write_html(
@@ -128,74 +196,10 @@ namespace rune {
         }
 
         void write_cells_gzip(
-            gzFile gz,
-            rune::converter::ImageBuffer& image_buffer,
-            const std::vector<rune::Cell>& cells
+            GzipWriter& gz,
+            const rune::CellBuffer& cells
         ) {
-            auto write = [&](const std::string& s) {
-                gzwrite(gz, s.data(), static_cast<unsigned int>(s.size()));
-            };
-
-            write(R"({"cells":[)");
-
-            for (size_t i = 0; i < cells.size(); ++i) {
-                const auto& c = cells[i];
-
-                write(R"({"g":")");
-
-                // Escape special JSON characters and encode UTF-8 as \uXXXX
-                if (c.glyph == "\\") {
-                    write("\\\\");
-                } else if (c.glyph == "\"") {
-                    write("\\\"");
-                } else if (c.glyph == "\b") {
-                    write("\\b");
-                } else if (c.glyph == "\f") {
-                    write("\\f");
-                } else if (c.glyph == "\n") {
-                    write("\\n");
-                } else if (c.glyph == "\r") {
-                    write("\\r");
-                } else if (c.glyph == "\t") {
-                    write("\\t");
-                } else if (c.glyph.size() == 1 && static_cast<unsigned char>(c.glyph[0]) < 128) {
-                    // ASCII character - output directly
-                    write(c.glyph);
-                } else {
-                    // Multi-byte UTF-8 - convert to Unicode code point and escape as \uXXXX
-                    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(c.glyph.data());
-                    uint32_t codepoint = 0;
-                    
-                    if ((bytes[0] & 0x80) == 0) {
-                        codepoint = bytes[0];
-                    } else if ((bytes[0] & 0xE0) == 0xC0 && c.glyph.size() >= 2) {
-                        codepoint = ((bytes[0] & 0x1F) << 6) | (bytes[1] & 0x3F);
-                    } else if ((bytes[0] & 0xF0) == 0xE0 && c.glyph.size() >= 3) {
-                        codepoint = ((bytes[0] & 0x0F) << 12) | ((bytes[1] & 0x3F) << 6) | (bytes[2] & 0x3F);
-                    } else if ((bytes[0] & 0xF8) == 0xF0 && c.glyph.size() >= 4) {
-                        codepoint = ((bytes[0] & 0x07) << 18) | ((bytes[1] & 0x3F) << 12) | ((bytes[2] & 0x3F) << 6) | (bytes[3] & 0x3F);
-                    }
-                    
-                    // Output as \uXXXX
-                    std::stringstream ss;
-                    ss << "\\u" << std::hex << std::setfill('0') << std::setw(4) << codepoint;
-                    write(ss.str());
-                }
-
-                write(R"(","h":)");
-                write(std::to_string(static_cast<int>(c.h))); // h is degrees (0-360)
-                write(R"(,"s":)");
-                write(std::to_string(static_cast<int>(c.s * 100.0f))); // s is ratio -> percentage (0-100)
-                write(R"(,"l":)");
-                write(std::to_string(static_cast<int>(c.l * 100.0f))); // l is ratio -> percentage (0-100)
-                write("}");
-
-                if (i + 1 < cells.size()) {
-                    write(",");
-                }
-            }
-
-            write("]}\n");
+            gz.write(local_serializer().serialize_cells(cells));
         }
         
         
@@ -204,16 +208,448 @@ namespace rune {
             const rune::converter::ImageBuffer& image_buffer, 
             const std::string& type = "video",
             int fps = 0,
-            int frame_count = 1
+            int frame_count = 1,
+            int keyframe_interval,
+            const std::string& stylesheet,
+            const std::string& playlist
         ) {
             out << "{\n";
             out << "  \"cols\": " << image_buffer.width << ",\n";
-            out << "  \"rows\": " << image_buffer.height / 2 << ",\n";
+            out << "  \"rows\": " << image_buffer.height << ",\n";
             out << "  \"channels\": " << image_buffer.channels << ",\n";
             out << "  \"type\": " << "\"" << type << "\""<< ",\n";
             out << "  \"fps\": " << fps << ",\n";
+            if (keyframe_interval > 0) {
+                out << "  \"keyframe_interval\": " << keyframe_interval << ",\n";
+            }
+            if (!stylesheet.empty()) {
+                out << "  \"stylesheet\": \"" << stylesheet << "\",\n";
+            }
+            if (!playlist.empty()) {
+                out << "  \"playlist\": \"" << playlist << "\",\n";
+            }
             out << "  \"frame_count\": " << frame_count << "\n";
             out << "}\n";
         }
+
+        void write_ladder_manifest(
+            std::ostream& out,
+            const std::string& type,
+            int fps,
+            int frame_count,
+            std::vector<Rendition> renditions
+        ) {
+            std::stable_sort(renditions.begin(), renditions.end(), [](const Rendition& a, const Rendition& b) { return a.cols < b.cols; });
+
+            out << "{\n";
+            out << "  \"type\": " << "\"" << type << "\""<< ",\n";
+            out << "  \"fps\": " << fps << ",\n";
+            out << "  \"frame_count\": " << frame_count << ",\n";
+            out << "  \"renditions\": [";
+            for (size_t i = 0; i < renditions.size(); ++i) {
+                const Rendition& r = renditions[i];
+                out << (i == 0 ? "\n" : ",\n")
+                    << "    { \"cols\": " << r.cols
+                    << ", \"rows\": " << r.rows
+                    << ", \"path\": \"" << r.path << "\""
+                    << ", \"bytes\": " << r.bytes << " }";
+            }
+            out << "\n  ]\n";
+            out << "}\n";
+        }
+
+        DeltaEncoder::DeltaEncoder(int keyframe_interval, int tolerance)
+            : keyframe_interval_(keyframe_interval < 1 ? 1 : keyframe_interval), tolerance_(tolerance < 0 ? 0 : tolerance) {}
+
+        bool DeltaEncoder::changed(const rune::CellBuffer& cells, size_t i) const {
+            if (cells.glyphs[i] != reference_.glyphs[i]) return true;
+
+            // Hue wraps around, so 359 and 1 are two degrees apart
+            int dh = std::abs(static_cast<int>(cells.h[i]) - static_cast<int>(reference_.h[i]));
+            dh = std::min(dh, 360 - dh);
+
+            return dh > tolerance_
+                || std::abs(cells.s[i] - reference_.s[i]) > tolerance_
+                || std::abs(cells.l[i] - reference_.l[i]) > tolerance_;
+        }
+
+        bool DeltaEncoder::encode(const rune::CellBuffer& cells, std::vector<CellSpan>& spans) {
+            spans.clear();
+
+            const bool keyframe = frame_ % keyframe_interval_ == 0
+                || force_keyframe_
+                || cells.cols != reference_.cols
+                || cells.rows != reference_.rows;
+            frame_++;
+            force_keyframe_ = false;
+
+            if (keyframe) {
+                reference_ = cells;
+                return true;
+            }
+
+            const size_t count = cells.size();
+            size_t i = 0;
+            while (i < count) {
+                if (!changed(cells, i)) {
+                    i++;
+                    continue;
+                }
+
+                size_t begin = i;
+                while (i < count && changed(cells, i)) {
+                    reference_.glyphs[i] = cells.glyphs[i];
+                    reference_.h[i] = cells.h[i];
+                    reference_.s[i] = cells.s[i];
+                    reference_.l[i] = cells.l[i];
+                    i++;
+                }
+                spans.push_back(CellSpan { static_cast<uint32_t>(begin), static_cast<uint32_t>(i) });
+            }
+
+            return false;
+        }
+
+        void write_delta(
+            std::ostream& out,
+            const rune::CellBuffer& cells,
+            const std::vector<CellSpan>& spans
+        ) {
+            std::string_view frame = local_serializer().serialize_delta(cells, spans);
+            out.write(frame.data(), static_cast<std::streamsize>(frame.size()));
+        }
+
+        void write_delta_gzip(
+            GzipWriter& gz,
+            const rune::CellBuffer& cells,
+            const std::vector<CellSpan>& spans
+        ) {
+            gz.write(local_serializer().serialize_delta(cells, spans));
+        }
+
+        void write_seek_index(
+            std::ostream& out,
+            int interval,
+            const std::vector<SeekPoint>& points,
+            uint64_t size,
+            uint64_t raw_size
+        ) {
+            out << R"({"interval":)" << interval
+                << R"(,"size":)" << size
+                << R"(,"raw_size":)" << raw_size
+                << R"(,"points":[)";
+
+            for (size_t i = 0; i < points.size(); ++i) {
+                if (i != 0) out << ",";
+                out << R"({"frame":)" << points[i].frame
+                    << R"(,"offset":)" << points[i].offset
+                    << R"(,"raw_offset":)" << points[i].raw_offset << "}";
+            }
+
+            out << "]}\n";
+        }
+
+        FrameOutputs::~FrameOutputs() {
+            close();
+        }
+
+        std::unique_ptr<rune::io::WriteQueue> make_write_queue(const rune::converter::ConvertOptions& options) {
+            if (options.io_queue_mb <= 0) {
+                return nullptr;
+            }
+
+            // The converting thread only waits on the disk once this much is queued
+            rune::io::WriteQueue::Options io_options;
+            io_options.max_queued_bytes = static_cast<size_t>(options.io_queue_mb) << 20;
+            io_options.io_uring = options.io_uring;
+            io_options.sync_on_close = options.fsync;
+            return std::make_unique<rune::io::WriteQueue>(io_options);
+        }
+
+        bool FrameOutputs::open(const std::string& filename_base, int fps, const rune::converter::ConvertOptions& options, rune::io::WriteQueue* queue) {
+            format_ = options.format;
+            filename_base_ = filename_base;
+            options_ = options;
+            fps_ = fps;
+            seek_interval_ = options.seek_interval;
+            frames_written_ = 0;
+            main_bytes_ = 0;
+            segments_.clear();
+            cols_ = rows_ = 0;
+
+            // Stills have no timeline, so only a video can be segmented
+            segment_frames_ = (options.segment_seconds > 0 && fps > 0)
+                ? std::max(1, static_cast<int>(std::lround(options.segment_seconds * fps)))
+                : 0;
+
+            // Delta frames only apply to the JSON outputs; frames.txt stays self-contained per frame
+            delta_.reset();
+            if (format_ == rune::converter::OutputFormat::Jsonl && options.keyframe_interval > 1) {
+                delta_ = std::make_unique<DeltaEncoder>(options.keyframe_interval, options.delta_tolerance);
+            }
+
+            // Every frame shares one palette, so its stylesheet is written up front
+            if (format_ == rune::converter::OutputFormat::Jsonl && options.palette_size > 0) {
+                palette_ = std::make_unique<rune::palette::Palette>(options.palette_size);
+
+                std::ofstream css_out(filename_base + ".css");
+                if (!css_out) {
+                    std::cerr << "failed to open output file\n";
+                    return false;
+                }
+                palette_->write_stylesheet(css_out);
+            }
+
+            io_ = queue;
+
+            open_ = open_files(segment_frames_ > 0 ? filename_base + "_00000" : filename_base);
+            return open_;
+        }
+
+        bool FrameOutputs::open_files(const std::string& base) {
+            files_base_ = base;
+            frames_in_files_ = 0;
+            seek_points_.clear();
+
+            if (format_ == rune::converter::OutputFormat::Runeb) {
+                if (!runeb_.open(base + ".runeb", fps_, options_.deflate_frames, 6, io_)) {
+                    std::cerr << "failed to open output file\n";
+                    return false;
+                }
+                return true;
+            }
+
+            std::string filename_jsonl_gzip = base + ".jsonl.gz";
+            // Parallel deflate is opt-in: its blocks compress differently from one zlib
+            // stream, so the .gz bytes depend on the gzip thread count
+            const int gzip_threads = options_.gzip_threads > 0 ? options_.gzip_threads : options_.threads;
+            if (!gz_.open(filename_jsonl_gzip, options_.gzip_level, gzip_threads, static_cast<size_t>(options_.gzip_block_kb) * 1024, io_)) {
+                std::cerr << "failed to open gzip file\n";
+                return false;
+            }
+
+            std::string filename_jsonl = base + ".jsonl";
+            std::string filename_html = base + ".txt";
+            if (io_) {
+                j_file_ = io_->open(filename_jsonl);
+                h_file_ = io_->open(filename_html);
+                if (j_file_ < 0 || h_file_ < 0) {
+                    std::cerr << "failed to open output file\n";
+                    return false;
+                }
+                return true;
+            }
+
+            j_data_out_.open(filename_jsonl, std::ios::out | std::ios::app);
+            if (!j_data_out_) {
+                std::cerr << "failed to open output file\n";
+                return false;
+            }
+
+            h_data_out_.open(filename_html, std::ios::out | std::ios::app);
+            if (!h_data_out_) {
+                std::cerr << "failed to open output file\n";
+                return false;
+            }
+
+            return true;
+        }
+
+        void FrameOutputs::write_frame(const rune::converter::AsciiFrame& ascii_frame) {
+            if (segment_frames_ > 0) {
+                if (frames_written_ == 0) {
+                    cols_ = ascii_frame.cells.cols;
+                    rows_ = ascii_frame.cells.rows;
+                }
+
+                // A full segment is closed and published before the next one starts,
+                // and the new one opens on a keyframe so it decodes on its own
+                if (frames_in_files_ == segment_frames_) {
+                    finish_segment(false);
+                    char suffix[16];
+                    std::snprintf(suffix, sizeof(suffix), "_%05d", static_cast<int>(segments_.size()));
+                    if (!open_files(filename_base_ + suffix)) {
+                        throw std::runtime_error("failed to open segment files");
+                    }
+                    if (delta_) delta_->force_keyframe();
+                }
+            }
+
+            if (format_ == rune::converter::OutputFormat::Runeb) {
+                profile::Timer timer(profile::Stage::WriteRuneb);
+                runeb_.write_frame(ascii_frame.cells);
+                frames_written_++;
+                frames_in_files_++;
+                return;
+            }
+
+            // Each seek point starts an independent gzip member, and with delta frames
+            // also a keyframe, so a reader can decode from there without earlier data
+            if (seek_interval_ > 0 && frames_in_files_ % seek_interval_ == 0) {
+                gz_.start_member();
+                seek_points_.push_back(SeekPoint { frames_in_files_, gz_.compressed_offset(), gz_.uncompressed_offset() });
+                if (delta_) delta_->force_keyframe();
+            }
+            frames_written_++;
+            frames_in_files_++;
+
+            // Serialized once, then handed to every JSON sink as a single block
+            std::string_view frame;
+            {
+                profile::Timer timer(profile::Stage::Serialize);
+                frame = (delta_ && !delta_->encode(ascii_frame.cells, spans_))
+                    ? serializer_.serialize_delta(ascii_frame.cells, spans_)
+                    : serializer_.serialize_cells(ascii_frame.cells);
+            }
+            {
+                profile::Timer timer(profile::Stage::WriteJsonl);
+                if (io_) {
+                    io_->write(j_file_, frame);
+                } else {
+                    j_data_out_.write(frame.data(), static_cast<std::streamsize>(frame.size()));
+                }
+            }
+            {
+                profile::Timer timer(profile::Stage::WriteGzip);
+                gz_.write(frame);
+            }
+            {
+                profile::Timer timer(profile::Stage::WriteHtml);
+                if (io_) {
+                    io_->write(h_file_, ascii_frame.html);
+                    io_->write(h_file_, "\n");
+                } else {
+                    write_html(h_data_out_, ascii_frame.html);
+                }
+            }
+        }
+
+        uint64_t FrameOutputs::close_files() {
+            if (gz_.is_open()) {
+                gz_.close();
+
+                if (seek_interval_ > 0) {
+                    std::ofstream index_out(files_base_ + ".jsonl.gz.index.json");
+                    if (!index_out) {
+                        std::cerr << "failed to open output file\n";
+                    } else {
+                        write_seek_index(index_out, seek_interval_, seek_points_, gz_.compressed_offset(), gz_.uncompressed_offset());
+                    }
+                }
+            }
+            if (j_data_out_.is_open()) j_data_out_.close();
+            if (h_data_out_.is_open()) h_data_out_.close();
+            runeb_.close();
+
+            // Waits for the I/O thread, so the sizes below (and any playlist that lists
+            // these files) only ever describe complete files
+            bool written = true;
+            for (int* file : { &j_file_, &h_file_ }) {
+                if (*file >= 0) {
+                    written = io_->close(*file) && written;
+                    *file = -1;
+                }
+            }
+            if (!written) {
+                std::cerr << "failed to write output file\n";
+            }
+
+            std::error_code ec;
+            const uint64_t bytes = std::filesystem::file_size(files_base_ + (format_ == rune::converter::OutputFormat::Runeb ? ".runeb" : ".jsonl.gz"), ec);
+            if (ec) {
+                return 0;
+            }
+            main_bytes_ += bytes;
+            return bytes;
+        }
+
+        void FrameOutputs::finish_segment(bool complete) {
+            const uint64_t bytes = close_files();
+
+            // An empty trailing segment (no frames since the last cut) is dropped
+            if (frames_in_files_ > 0) {
+                segments_.push_back(Segment {
+                    std::filesystem::path(files_base_).filename().string(),
+                    frames_written_ - frames_in_files_,
+                    frames_in_files_,
+                    bytes
+                });
+            } else {
+                for (const char* extension : { ".runeb", ".jsonl.gz", ".jsonl", ".txt", ".jsonl.gz.index.json" }) {
+                    std::error_code ec;
+                    std::filesystem::remove(files_base_ + extension, ec);
+                }
+            }
+
+            // Written beside the frames and renamed over the old playlist, so a reader
+            // polling it during a live conversion never sees a partial file
+            const std::filesystem::path folder = std::filesystem::path(filename_base_).parent_path();
+            const std::filesystem::path playlist = folder / playlist_name();
+            const std::filesystem::path temp = folder / (playlist_name() + ".tmp");
+            {
+                std::ofstream out(temp);
+                if (!out) {
+                    std::cerr << "failed to open output file\n";
+                    return;
+                }
+                const std::string stylesheet = palette_ ? std::filesystem::path(filename_base_).filename().string() + ".css" : "";
+                write_playlist(out, cols_, rows_, fps_, segment_frames_, segments_, complete, stylesheet);
+            }
+            std::error_code ec;
+            std::filesystem::rename(temp, playlist, ec);
+            if (ec) {
+                std::cerr << "failed to open output file\n";
+            }
+        }
+
+        void FrameOutputs::close() {
+            if (!open_) {
+                return;
+            }
+            open_ = false;
+
+            if (segment_frames_ > 0) {
+                finish_segment(true);
+                return;
+            }
+            close_files();
+        }
+
+        void write_playlist(
+            std::ostream& out,
+            int cols,
+            int rows,
+            int fps,
+            int segment_frames,
+            const std::vector<Segment>& segments,
+            bool complete,
+            const std::string& stylesheet
+        ) {
+            int frame_count = 0;
+            for (const Segment& segment : segments) frame_count += segment.frame_count;
+
+            out << "{\n";
+            out << "  \"cols\": " << cols << ",\n";
+            out << "  \"rows\": " << rows << ",\n";
+            out << "  \"fps\": " << fps << ",\n";
+            out << "  \"segment_frames\": " << segment_frames << ",\n";
+            if (!stylesheet.empty()) {
+                out << "  \"stylesheet\": \"" << stylesheet << "\",\n";
+            }
+            out << "  \"frame_count\": " << frame_count << ",\n";
+            out << "  \"complete\": " << (complete ? "true" : "false") << ",\n";
+            out << "  \"segments\": [";
+            for (size_t i = 0; i < segments.size(); ++i) {
+                const Segment& segment = segments[i];
+                out << (i == 0 ? "\n" : ",\n")
+                    << "    { \"name\": \"" << segment.name << "\""
+                    << ", \"first_frame\": " << segment.first_frame
+                    << ", \"frame_count\": " << segment.frame_count
+                    << ", \"duration\": " << (fps > 0 ? static_cast<double>(segment.frame_count) / fps : 0.0)
+                    << ", \"bytes\": " << segment.bytes << " }";
+            }
+            out << (segments.empty() ? "]\n" : "\n  ]\n");
+            out << "}\n";
+        }
     }
 }
\ No newline at end of file
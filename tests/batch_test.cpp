@@ -0,0 +1,67 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "rune/batch.hpp"
+
+namespace {
+
+    // A tiny binary PNM (P5 grey or P6 RGB), which stb_image decodes
+    void write_pnm(const std::filesystem::path& path, bool rgb) {
+        const int width = 8, height = 4, channels = rgb ? 3 : 1;
+        std::ofstream out(path, std::ios::binary);
+        out << (rgb ? "P6" : "P5") << "\n" << width << " " << height << "\n255\n";
+        for (int i = 0; i < width * height * channels; ++i) out.put(static_cast<char>(i * 7));
+    }
+
+} // namespace
+
+// Stems that clash with each other's numeric suffixes must still get distinct subfolders
+int main() {
+    namespace fs = std::filesystem;
+
+    const fs::path root = fs::temp_directory_path() / "rune_batch_test";
+    fs::remove_all(root);
+    fs::create_directories(root / "in");
+
+    // "a.pgm" and "a.ppm" share a stem, and the second one's "a_1" is also "a_1.ppm"'s stem
+    write_pnm(root / "in" / "a.pgm", false);
+    write_pnm(root / "in" / "a.ppm", true);
+    write_pnm(root / "in" / "a_1.ppm", true);
+
+    rune::converter::ConvertOptions options;
+    options.threads = 2;
+    options.quiet = true;
+
+    const std::vector<std::string> inputs = rune::batch::collect_inputs((root / "in").string());
+    const std::vector<rune::batch::ImageResult> results =
+        rune::batch::convert_images(inputs, 8, (root / "out").string(), rune::ramps::SIMPLE, 0.0f, options);
+
+    int failures = 0;
+    std::set<std::string> folders;
+    for (const auto& result : results) {
+        if (!result.ok) {
+            std::printf("%s failed: %s\n", result.input.c_str(), result.error.c_str());
+            failures++;
+        }
+        if (!folders.insert(result.output_folder).second) {
+            std::printf("%s shares output folder %s\n", result.input.c_str(), result.output_folder.c_str());
+            failures++;
+        }
+        if (!fs::exists(fs::path(result.output_folder) / "manifest.json")) {
+            std::printf("%s: no manifest in %s\n", result.input.c_str(), result.output_folder.c_str());
+            failures++;
+        }
+    }
+    if (results.size() != 3) {
+        std::printf("expected 3 results, got %zu\n", results.size());
+        failures++;
+    }
+
+    fs::remove_all(root);
+    std::printf("batch: %d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
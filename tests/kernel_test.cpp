@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "rune/kernel.hpp"
+
+// Every vector path of kernel::map_row must agree with the scalar path exactly,
+// over the whole RGB cube, for several thresholds and ramp lengths
+int main() {
+    using rune::kernel::Isa;
+
+    const Isa best = rune::kernel::detect_isa();
+    std::vector<Isa> isas;
+    for (Isa isa : { Isa::SSE41, Isa::AVX2 }) {
+        if (static_cast<int>(isa) <= static_cast<int>(best)) isas.push_back(isa);
+    }
+    if (isas.empty()) {
+        std::printf("map_row: no vector instruction set on this CPU, nothing to compare\n");
+        return 0;
+    }
+
+    // Rows of an odd length so every path also runs its tail
+    constexpr int ROW = 4099;
+    constexpr uint32_t CUBE = 1u << 24;
+
+    // The cube as packed RGB24 (stride 3) and, for the strided case, RGBA (stride 4)
+    std::vector<uint8_t> rgb(static_cast<size_t>(CUBE) * 3);
+    std::vector<uint8_t> rgba(static_cast<size_t>(CUBE) * 4);
+    for (uint32_t c = 0; c < CUBE; ++c) {
+        const uint8_t r = static_cast<uint8_t>(c >> 16), g = static_cast<uint8_t>(c >> 8), b = static_cast<uint8_t>(c);
+        rgb[c * 3] = r; rgb[c * 3 + 1] = g; rgb[c * 3 + 2] = b;
+        rgba[c * 4] = r; rgba[c * 4 + 1] = g; rgba[c * 4 + 2] = b; rgba[c * 4 + 3] = 255;
+    }
+
+    struct Row {
+        std::vector<uint8_t> glyphs, s, l;
+        std::vector<uint16_t> h;
+        Row() : glyphs(ROW), s(ROW), l(ROW), h(ROW) {}
+    };
+    Row expected, actual;
+
+    const float thresholds[] = { 0.0f, 0.35f, 0.6f, 1.0f };
+    const int last_glyphs[] = { 1, 9, 68, 255 };
+
+    uint64_t mismatches = 0;
+    for (float threshold : thresholds) {
+        for (int last_glyph : last_glyphs) {
+            for (uint32_t first = 0; first < CUBE; first += ROW) {
+                const int count = static_cast<int>(std::min<uint32_t>(ROW, CUBE - first));
+                // Packed rows cover the whole cube; every 16th row also goes through the strided layout
+                const bool strided = (first / ROW) % 16 == 0;
+
+                for (int pass = 0; pass < (strided ? 2 : 1); ++pass) {
+                    const uint8_t* pixels = pass == 0 ? rgb.data() + static_cast<size_t>(first) * 3 : rgba.data() + static_cast<size_t>(first) * 4;
+                    const int stride = pass == 0 ? 3 : 4;
+
+                    rune::kernel::map_row(Isa::Scalar, pixels, count, stride, threshold, last_glyph,
+                        expected.glyphs.data(), expected.h.data(), expected.s.data(), expected.l.data());
+
+                    for (Isa isa : isas) {
+                        rune::kernel::map_row(isa, pixels, count, stride, threshold, last_glyph,
+                            actual.glyphs.data(), actual.h.data(), actual.s.data(), actual.l.data());
+
+                        for (int x = 0; x < count; ++x) {
+                            if (expected.glyphs[x] == actual.glyphs[x] && expected.h[x] == actual.h[x]
+                                && expected.s[x] == actual.s[x] && expected.l[x] == actual.l[x]) {
+                                continue;
+                            }
+                            if (mismatches++ < 10) {
+                                const uint32_t c = first + static_cast<uint32_t>(x);
+                                std::printf("%s threshold %.2f last glyph %d: rgb(%u,%u,%u) gives %u/%u/%u/%u, scalar %u/%u/%u/%u\n",
+                                    rune::kernel::isa_name(isa), threshold, last_glyph, c >> 16, (c >> 8) & 255, c & 255,
+                                    actual.glyphs[x], actual.h[x], actual.s[x], actual.l[x],
+                                    expected.glyphs[x], expected.h[x], expected.s[x], expected.l[x]);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    for (Isa isa : isas) {
+        std::printf("map_row %s: compared with scalar over the RGB cube\n", rune::kernel::isa_name(isa));
+    }
+
+    if (mismatches != 0) {
+        std::printf("map_row: %llu mismatches\n", static_cast<unsigned long long>(mismatches));
+        return 1;
+    }
+    return 0;
+}
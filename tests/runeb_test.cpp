@@ -0,0 +1,131 @@
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "rune/runeb.hpp"
+
+namespace {
+
+    int failures = 0;
+
+    void check(bool ok, const char* what) {
+        if (!ok) {
+            std::printf("FAILED: %s\n", what);
+            failures++;
+        }
+    }
+
+    rune::CellBuffer make_frame(int frame) {
+        rune::CellBuffer cells;
+        cells.glyph_table = { " ", ".", "░", "█" };
+        cells.resize(7, 3);
+        for (size_t i = 0; i < cells.size(); ++i) {
+            cells.glyphs[i] = static_cast<uint8_t>((i + frame) % 4);
+            cells.h[i] = static_cast<uint16_t>((i * 37 + frame) % 361);
+            cells.s[i] = static_cast<uint8_t>((i * 11 + frame) % 101);
+            cells.l[i] = static_cast<uint8_t>((i * 5 + frame * 3) % 101);
+        }
+        return cells;
+    }
+
+    std::vector<char> read_file(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(in), {});
+    }
+
+    void write_file(const std::string& path, const std::vector<char>& bytes) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+
+    void put_u32(std::vector<char>& bytes, size_t at, uint32_t v) {
+        for (int i = 0; i < 4; ++i) bytes[at + i] = static_cast<char>(v >> (8 * i));
+    }
+
+    uint64_t get_u64(const std::vector<char>& bytes, size_t at) {
+        uint64_t v = 0;
+        for (int i = 0; i < 8; ++i) v |= static_cast<uint64_t>(static_cast<uint8_t>(bytes[at + i])) << (8 * i);
+        return v;
+    }
+
+    // A corrupted header must be refused with a runtime_error, never a huge allocation
+    void expect_rejected(const std::string& path, const std::vector<char>& bytes, const char* what) {
+        write_file(path, bytes);
+        try {
+            rune::runeb::Reader reader(path);
+            check(false, what);
+        } catch (const std::runtime_error&) {
+        } catch (const std::exception& e) {
+            std::printf("%s: wrong exception: %s\n", what, e.what());
+            failures++;
+        }
+    }
+
+} // namespace
+
+// Frames written to a .runeb file read back unchanged, and a damaged header is refused
+int main() {
+    namespace fs = std::filesystem;
+    const std::string path = (fs::temp_directory_path() / "rune_runeb_test.runeb").string();
+    constexpr int FRAMES = 5;
+
+    for (bool deflate : { false, true }) {
+        {
+            rune::runeb::Writer writer;
+            check(writer.open(path, 12, deflate), "open for writing");
+            for (int f = 0; f < FRAMES; ++f) writer.write_frame(make_frame(f));
+            writer.close();
+        }
+
+        rune::runeb::Reader reader(path);
+        check(reader.frame_count() == FRAMES, "frame count");
+        check(reader.header().cols == 7 && reader.header().rows == 3 && reader.header().fps == 12, "geometry");
+        check(reader.header().glyph_table == make_frame(0).glyph_table, "glyph table");
+
+        // Out of order, to exercise the index
+        rune::CellBuffer cells;
+        for (int f : { 3, 0, 4, 1, 2 }) {
+            reader.read_frame(f, cells);
+            const rune::CellBuffer expected = make_frame(f);
+            check(cells.cols == expected.cols && cells.rows == expected.rows, "frame geometry");
+            check(cells.glyphs == expected.glyphs && cells.h == expected.h && cells.s == expected.s && cells.l == expected.l,
+                  deflate ? "deflated frame round trip" : "frame round trip");
+        }
+    }
+
+    const std::vector<char> good = read_file(path);
+    const uint64_t index_offset = get_u64(good, 24);
+
+    std::vector<char> bad = good;
+    put_u32(bad, 20, 0xFFFFFFFFu);
+    expect_rejected(path, bad, "negative frame count");
+
+    bad = good;
+    put_u32(bad, 20, 0x7FFFFFFFu);
+    expect_rejected(path, bad, "index past the end of the file");
+
+    bad = good;
+    put_u32(bad, 32, 0xFFFFFFFFu);
+    expect_rejected(path, bad, "oversized glyph count");
+
+    bad = good;
+    put_u32(bad, 8, 0);
+    expect_rejected(path, bad, "zero cols");
+
+    bad = good;
+    put_u32(bad, 12, 1u << 20);
+    expect_rejected(path, bad, "oversized rows");
+
+    bad = good;
+    put_u32(bad, static_cast<size_t>(index_offset) + 8, 0xFFFFFFF0u);
+    expect_rejected(path, bad, "stored size past the end of the file");
+
+    fs::remove(path);
+    std::printf("runeb: %d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}